@@ -0,0 +1,68 @@
+/**
+ * @file AllocTracker.cpp
+ * @brief Allocation counters and the counting global allocator.
+ */
+#include "AllocTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+namespace {
+    atomic<uint64_t> totalCount{ 0 };
+    atomic<uint64_t> totalBytes{ 0 };
+
+    // Counts of the innermost AllocScope of each thread
+    thread_local AllocCounts* currentCounts = nullptr;
+}
+
+
+bool alloc_tracking_enabled() {
+#ifdef BRACKETCHECKER_ALLOC_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocCounts alloc_totals() {
+    AllocCounts totals;
+    totals.count = totalCount.load(memory_order_relaxed);
+    totals.bytes = totalBytes.load(memory_order_relaxed);
+    return totals;
+}
+
+
+AllocScope::AllocScope(AllocCounts& counts) : previous(currentCounts) {
+    currentCounts = &counts;
+}
+
+AllocScope::~AllocScope() {
+    currentCounts = previous;
+}
+
+
+#ifdef BRACKETCHECKER_ALLOC_TRACKING
+// The array and nothrow forms call this one, so replacing it counts them all
+void* operator new(size_t size) {
+    totalCount.fetch_add(1, memory_order_relaxed);
+    totalBytes.fetch_add(size, memory_order_relaxed);
+    if (AllocCounts* counts = currentCounts) {
+        counts->count++;
+        counts->bytes += size;
+    }
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+#endif
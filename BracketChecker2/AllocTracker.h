@@ -0,0 +1,62 @@
+/**
+ * @file AllocTracker.h
+ * @brief Opt-in accounting of heap allocations per phase.
+ *
+ * Builds that define BRACKETCHECKER_ALLOC_TRACKING (the tests and the
+ * benchmark) compile AllocTracker.cpp with a counting replacement of the
+ * global operator new. An AllocScope then attributes the allocations of its
+ * thread to an AllocCounts while it is alive, so a test can give each phase
+ * an allocation budget. Other builds replace nothing: alloc_tracking_enabled()
+ * is false and all counts stay 0.
+ */
+
+#pragma once
+#ifndef ALLOCTRACKER_H
+#define ALLOCTRACKER_H
+
+#include <cstdint>
+#include "BracketChecker2.h"
+
+
+/**
+ * @struct AllocCounts
+ * @brief Number and total size of allocations.
+ */
+struct AllocCounts {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+
+/**
+ * @brief True if this build counts allocations.
+ */
+bool alloc_tracking_enabled();
+
+
+/**
+ * @brief Allocations of all threads since the program started.
+ */
+AllocCounts alloc_totals();
+
+
+/**
+ * @class AllocScope
+ * @brief Adds the allocations of the calling thread to counts during its lifetime.
+ *
+ * Scopes nest; only the innermost one receives the allocations.
+ */
+class AllocScope {
+public:
+    explicit AllocScope(AllocCounts& counts);
+    ~AllocScope();
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+    AllocCounts* previous;
+};
+
+
+#endif // ALLOCTRACKER_H
@@ -0,0 +1,161 @@
+/**
+ * @file AsyncChecker.cpp
+ * @brief Implementation of the awaitable file checks.
+ */
+#include "AsyncChecker.h"
+#include "BracketCheckerEngine.h"
+#include "TraceLog.h"
+
+
+void AsyncChecker::WorkerPool::start(unsigned count) {
+    for (unsigned i = 0; i < count; i++) {
+        threads.emplace_back([this] { run(); });
+    }
+}
+
+void AsyncChecker::WorkerPool::post(function<void()> job) {
+    {
+        lock_guard<mutex> guard(queueLock);
+        jobs.push_back(move(job));
+    }
+    queueReady.notify_one();
+}
+
+// Runs the jobs still queued, then joins the threads
+void AsyncChecker::WorkerPool::shutdown() {
+    {
+        lock_guard<mutex> guard(queueLock);
+        closing = true;
+    }
+    queueReady.notify_all();
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    threads.clear();
+}
+
+void AsyncChecker::WorkerPool::run() {
+    while (true) {
+        function<void()> job;
+        {
+            unique_lock<mutex> guard(queueLock);
+            queueReady.wait(guard, [this] { return closing || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            job = move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+
+AsyncChecker::AsyncChecker(SourceLanguage language, unsigned cpuWorkers, unsigned ioWorkers)
+    : language(language) {
+    if (cpuWorkers == 0) {
+        cpuWorkers = max(1u, thread::hardware_concurrency());
+    }
+    cpuPool.start(cpuWorkers);
+    ioPool.start(max(1u, ioWorkers));
+}
+
+AsyncChecker::~AsyncChecker() {
+    stopping = true;
+    // Reads post scans, so the I/O pool is drained first
+    ioPool.shutdown();
+    cpuPool.shutdown();
+}
+
+AsyncChecker::CheckFileAwaitable AsyncChecker::check_file_async(string path, stop_token stop, Clock::time_point deadline) {
+    SourceLanguage fileLanguage = language;
+    language_from_extension(path, fileLanguage);
+    return CheckFileAwaitable(this, Request{ move(path), move(stop), deadline, fileLanguage, {}, {}, {} });
+}
+
+// Records why a check has to stop early, if it has to
+bool AsyncChecker::interrupted(Request* request) const {
+    if (stopping || request->stop.stop_requested()) {
+        request->result.status = CHECK_CANCELLED;
+        return true;
+    }
+    if (request->deadline != Clock::time_point::max() && Clock::now() >= request->deadline) {
+        request->result.status = CHECK_DEADLINE_EXCEEDED;
+        return true;
+    }
+    return false;
+}
+
+void AsyncChecker::start(Request* request) {
+    ioPool.post([this, request] { read_stage(request); });
+}
+
+// Reads the file on an I/O thread, checking for cancellation after every chunk
+void AsyncChecker::read_stage(Request* request) {
+    bool complete = false;
+    {
+        TraceSpan span("read", &request->path);
+        complete = !interrupted(request) && read_contents(request);
+        span.set_bytes(request->contents.size());
+    }
+    // Spans end before the request is handed on; it may be destroyed right after
+    if (complete) {
+        cpuPool.post([this, request] { scan_stage(request); });
+    }
+    else {
+        request->handle.resume();
+    }
+}
+
+// Reads the whole file into the request, false if it has to stop early
+bool AsyncChecker::read_contents(Request* request) {
+    ifstream file(request->path, ios::binary);
+    if (!file.is_open()) {
+        request->result.status = CHECK_CANNOT_OPEN;
+        return false;
+    }
+
+    size_t used = 0;
+    while (file) {
+        request->contents.resize(used + BUDGET_CHECK_INTERVAL);
+        file.read(&request->contents[used], BUDGET_CHECK_INTERVAL);
+        used += static_cast<size_t>(file.gcount());
+        if (interrupted(request)) {
+            request->contents.clear();
+            return false;
+        }
+    }
+    // A failed read ends the loop like the end of the file does
+    if (file.bad() || !file.eof()) {
+        request->result.status = CHECK_READ_ERROR;
+        request->contents.clear();
+        return false;
+    }
+    request->contents.resize(used);
+    return true;
+}
+
+// Checks the contents on a CPU worker with that worker's reusable checker
+void AsyncChecker::scan_stage(Request* request) {
+    if (!interrupted(request)) {
+        TraceSpan span("parse", &request->path);
+        thread_local BracketChecker checker;
+        CheckBudget budget;
+        budget.deadline = request->deadline;
+        budget.stop = request->stop;
+        checker.set_language(request->language);
+        const auto& errors = checker.check(request->contents, &budget);
+        if (!budget.exceeded) {
+            request->result.errors.assign(errors.begin(), errors.end());
+        }
+        else if (!interrupted(request)) {
+            request->result.status = CHECK_DEADLINE_EXCEEDED;
+        }
+        span.set_bytes(request->contents.size());
+        span.set_errors(request->result.errors.size());
+    }
+    request->contents.clear();
+    request->contents.shrink_to_fit();
+    // The coroutine may destroy the request, so it is not touched afterwards
+    request->handle.resume();
+}
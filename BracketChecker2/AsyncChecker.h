@@ -0,0 +1,168 @@
+/**
+ * @file AsyncChecker.h
+ * @brief Awaitable file checks for coroutine-based services.
+ *
+ * AsyncChecker runs reads on a small I/O thread pool and scans on a pool of
+ * CPU workers, so a coroutine can check a file without blocking the thread
+ * it runs on:
+ * @code
+ * AsyncCheckResult result = co_await checker.check_file_async("main.cpp", stop, deadline);
+ * @endcode
+ * Thousands of checks can be in flight at once; each one only costs a queued
+ * request, not a thread.
+ */
+
+#pragma once
+#ifndef ASYNCCHECKER_H
+#define ASYNCCHECKER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include "BracketChecker2.h"
+
+
+/**
+ * @enum AsyncCheckStatus
+ * @brief How an asynchronous check ended.
+ */
+enum AsyncCheckStatus {
+    CHECK_COMPLETED,          ///< The file was read and checked; see errors
+    CHECK_CANNOT_OPEN,        ///< The file could not be opened
+    CHECK_CANCELLED,          ///< Stop was requested, or the checker is shutting down
+    CHECK_DEADLINE_EXCEEDED,  ///< The deadline passed before the check finished
+    CHECK_READ_ERROR          ///< The file was opened but could not be read, e.g. a directory
+};
+
+
+/**
+ * @struct AsyncCheckResult
+ * @brief Outcome of check_file_async().
+ */
+struct AsyncCheckResult {
+    AsyncCheckStatus status = CHECK_COMPLETED;
+    vector<BracketError> errors;  ///< Sorted errors, empty unless status is CHECK_COMPLETED
+};
+
+
+/**
+ * @class AsyncChecker
+ * @brief Owns the I/O and CPU worker pools behind check_file_async().
+ *
+ * The language of each file is chosen by language_from_extension(); files
+ * with an unknown extension use the language given at construction.
+ * Cancellation and the deadline are observed between the stages of a check
+ * and every BUDGET_CHECK_INTERVAL bytes while reading and scanning. The
+ * awaiting coroutine is resumed on one of the pool threads.
+ *
+ * check_file_async() may be called from any thread. All checks must have
+ * been started before the destructor runs; checks still queued then finish
+ * with CHECK_CANCELLED.
+ */
+class AsyncChecker {
+public:
+    using Clock = chrono::steady_clock;
+
+    class CheckFileAwaitable;
+
+    /**
+     * @brief Starts the worker pools.
+     * @param language [in] Language of files with an unknown extension.
+     * @param cpuWorkers [in] Scan threads; 0 uses the number of hardware threads.
+     * @param ioWorkers [in] Threads doing blocking reads.
+     */
+    explicit AsyncChecker(SourceLanguage language = LANGUAGE_CPP, unsigned cpuWorkers = 0, unsigned ioWorkers = 2);
+
+    /**
+     * @brief Finishes queued checks and joins all threads.
+     */
+    ~AsyncChecker();
+
+    AsyncChecker(const AsyncChecker&) = delete;
+    AsyncChecker& operator=(const AsyncChecker&) = delete;
+
+    /**
+     * @brief Checks a file without blocking the calling thread.
+     * @param path [in] Path to the input file.
+     * @param stop [in] Cancels the check when stop is requested.
+     * @param deadline [in] Time after which the check gives up.
+     * @return Awaitable yielding an AsyncCheckResult.
+     */
+    CheckFileAwaitable check_file_async(string path, stop_token stop = {},
+        Clock::time_point deadline = Clock::time_point::max());
+
+private:
+    /// One check in flight; lives in the awaiting coroutine frame.
+    struct Request {
+        string path;
+        stop_token stop;
+        Clock::time_point deadline;
+        SourceLanguage language;
+        string contents;
+        AsyncCheckResult result;
+        coroutine_handle<> handle;
+    };
+
+    /// Fixed set of threads running queued jobs in FIFO order.
+    class WorkerPool {
+    public:
+        void start(unsigned count);
+        void post(function<void()> job);
+        void shutdown();
+
+    private:
+        void run();
+
+        mutex queueLock;
+        condition_variable queueReady;
+        deque<function<void()>> jobs;
+        vector<thread> threads;
+        bool closing = false;
+    };
+
+    void start(Request* request);
+    void read_stage(Request* request);
+    bool read_contents(Request* request);
+    void scan_stage(Request* request);
+    bool interrupted(Request* request) const;
+
+    SourceLanguage language;
+    atomic<bool> stopping{ false };
+    WorkerPool ioPool;
+    WorkerPool cpuPool;
+};
+
+
+/**
+ * @class AsyncChecker::CheckFileAwaitable
+ * @brief Awaitable returned by check_file_async(); await it exactly once.
+ */
+class AsyncChecker::CheckFileAwaitable {
+public:
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(coroutine_handle<> handle) {
+        request.handle = handle;
+        owner->start(&request);
+    }
+
+    AsyncCheckResult await_resume() { return move(request.result); }
+
+private:
+    friend class AsyncChecker;
+
+    CheckFileAwaitable(AsyncChecker* owner, Request request) : owner(owner), request(move(request)) {
+    }
+
+    AsyncChecker* owner;
+    Request request;
+};
+
+
+#endif // ASYNCCHECKER_H
@@ -0,0 +1,158 @@
+/**
+ * @file BracketCheckConstexpr.h
+ * @brief Header-only constexpr bracket checker for string literals.
+ *
+ * bracket_check() applies the C/C++ rules of parse_brackets() to a
+ * std::string_view without allocating, so it can be evaluated at compile time:
+ * @code
+ * static_assert(bracket_check(R"({ "a": [1, 2] })").ok, "broken snippet");
+ * @endcode
+ * At run time it is a fully inlinable fast path for short buffers.
+ */
+
+#pragma once
+#ifndef BRACKETCHECKCONSTEXPR_H
+#define BRACKETCHECKCONSTEXPR_H
+
+#include <string_view>
+#include "BracketLanguages.h"
+
+
+/**
+ * @struct BracketCheckResult
+ * @brief Summary of a constexpr bracket check.
+ */
+struct BracketCheckResult {
+    bool ok;             ///< True if no bracket errors were found
+    int errors;          ///< Number of wrong and unmatched brackets
+    int line;            ///< Line of the first error (1-based), 0 if none
+    int column;          ///< Column of the first error (1-based), 0 if none
+    bool depthExceeded;  ///< Nesting was deeper than the checker's capacity
+};
+
+
+/**
+ * @brief Classification table of the C/C++ rules, shared by all calls.
+ */
+inline constexpr CharTable cppCharTable = make_char_table<CppLanguage>();
+
+
+/**
+ * @brief Checks brackets of C/C++ source text.
+ *
+ * Gives the same errors as parse_brackets() on the lines of @p source
+ * (a '\\r' before '\\n' is ignored like read_input_file() does).
+ * @tparam MaxDepth Capacity of the bracket stack.
+ * @param source [in] Source text, lines separated by '\\n'.
+ * @return Error count and position of the first error in (line, column) order.
+ */
+template <size_t MaxDepth = 256>
+constexpr BracketCheckResult bracket_check(std::string_view source) {
+    struct Entry {
+        char bracket;
+        int line;
+        int column;
+    };
+    Entry bracketStack[MaxDepth] = {};
+    size_t depth = 0;
+    BracketCheckResult result = { true, 0, 0, 0, false };
+    bool inBlockComment = false;
+
+    auto record = [&result](int line, int column) {
+        result.ok = false;
+        result.errors++;
+        if (result.line == 0 || line < result.line || (line == result.line && column < result.column)) {
+            result.line = line;
+            result.column = column;
+        }
+    };
+
+    size_t start = 0;
+    for (int lineNum = 1; start < source.size(); lineNum++) {
+        size_t end = source.find('\n', start);
+        size_t next = end + 1;
+        if (end == std::string_view::npos) {
+            end = source.size();
+            next = end;
+        }
+        else if (end > start && source[end - 1] == '\r') {
+            end--;
+        }
+        std::string_view line = source.substr(start, end - start);
+        start = next;
+
+        bool inString = false;
+        char stringDelimiter = '\0';
+        for (size_t i = 0; i < line.size(); i++) {
+            char ch = line[i];
+            unsigned char cls = cppCharTable.classes[static_cast<unsigned char>(ch)];
+            if (cls == 0) continue;
+
+            // Handle comments
+            if (inBlockComment) {
+                if ((cls & CHAR_BLOCK_CLOSE) && marker_at(line, i, "*/")) {
+                    inBlockComment = false;
+                    i++;
+                }
+                continue;
+            }
+            if ((cls & CHAR_LINE_COMMENT) && marker_at(line, i, "//")) {
+                break;
+            }
+            if ((cls & CHAR_BLOCK_OPEN) && marker_at(line, i, "/*")) {
+                inBlockComment = true;
+                i++;
+                continue;
+            }
+
+            // Handle strings
+            if (!inString && (cls & CHAR_QUOTE)) {
+                inString = true;
+                stringDelimiter = cppCharTable.delimiter[static_cast<unsigned char>(ch)];
+                continue;
+            }
+            else if (inString) {
+                if (ch == stringDelimiter) {
+                    // Linear overall: each backslash run is counted only by the quote after it
+                    int backslashes = 0;
+                    size_t j = i;
+                    while (j > 0 && line[--j] == '\\') {
+                        backslashes++;
+                    }
+                    if (backslashes % 2 == 0) {
+                        inString = false;
+                    }
+                }
+                continue;
+            }
+
+            // Handle brackets
+            int column = static_cast<int>(i + 1);
+            if (cls & CHAR_OPEN) {
+                if (depth == MaxDepth) {
+                    result.ok = false;
+                    result.depthExceeded = true;
+                    return result;
+                }
+                bracketStack[depth++] = { ch, lineNum, column };
+            }
+            else if (cls & CHAR_CLOSE) {
+                if (depth > 0 && bracketStack[depth - 1].bracket == cppCharTable.opener[static_cast<unsigned char>(ch)]) {
+                    depth--;
+                }
+                else {
+                    record(lineNum, column);
+                }
+            }
+        }
+    }
+    // Remaining opening brackets are unmatched
+    for (size_t k = 0; k < depth; k++) {
+        record(bracketStack[k].line, bracketStack[k].column);
+    }
+
+    return result;
+}
+
+
+#endif // BRACKETCHECKCONSTEXPR_H
@@ -3,43 +3,206 @@
  * @brief Implementation file for bracket validation functions.
  */
 #include "BracketChecker2.h"
+#include "BracketLanguages.h"
 
 
- // Reads lines from a given file and returns them as a vector of strings
-vector<string> read_input_file(const string& filename) {
-    ifstream file(filename);
-    vector<string> lines;
+ // Appends a Unicode code point to a UTF-8 string
+template <class String>
+static void append_utf8(String& out, unsigned int cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
 
-    if (!file.is_open()) {
-        cerr << "Error: Cannot open file " << filename << endl;
-        return {};
+// Converts UTF-16 code units to UTF-8. Runs of ASCII are copied four code units at a time.
+template <class String>
+static void decode_utf16_into(const char* data, size_t size, bool bigEndian, String& out) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    size_t units = size / 2;
+    size_t lo = bigEndian ? 1 : 0; // Offset of the low byte inside a code unit
+    out.clear();
+    out.reserve(units);
+
+    size_t i = 0;
+    while (i < units) {
+        // ASCII fast path: eight bytes hold four code units, all high bytes zero and low bytes < 0x80
+        if (i + 4 <= units) {
+            const unsigned char* p = bytes + 2 * i;
+            if ((p[1 - lo] | p[3 - lo] | p[5 - lo] | p[7 - lo]) == 0 &&
+                ((p[lo] | p[2 + lo] | p[4 + lo] | p[6 + lo]) & 0x80) == 0) {
+                char ascii[4] = { static_cast<char>(p[lo]), static_cast<char>(p[2 + lo]),
+                                  static_cast<char>(p[4 + lo]), static_cast<char>(p[6 + lo]) };
+                out.append(ascii, 4);
+                i += 4;
+                continue;
+            }
+        }
+
+        unsigned int unit = bytes[2 * i + lo] | (bytes[2 * i + 1 - lo] << 8);
+        i++;
+        if (unit >= 0xD800 && unit <= 0xDBFF && i < units) {
+            unsigned int next = bytes[2 * i + lo] | (bytes[2 * i + 1 - lo] << 8);
+            if (next >= 0xDC00 && next <= 0xDFFF) {
+                append_utf8(out, 0x10000 + ((unit - 0xD800) << 10) + (next - 0xDC00));
+                i++;
+                continue;
+            }
+        }
+        if (unit >= 0xD800 && unit <= 0xDFFF) {
+            unit = 0xFFFD; // Unpaired surrogate
+        }
+        append_utf8(out, unit);
+    }
+}
+
+void decode_utf16_to_utf8(const char* data, size_t size, bool bigEndian, string& out) {
+    decode_utf16_into(data, size, bigEndian, out);
+}
+
+void decode_utf16_to_utf8(const char* data, size_t size, bool bigEndian, pmr::string& out) {
+    decode_utf16_into(data, size, bigEndian, out);
+}
+
+string decode_utf16_to_utf8(const char* data, size_t size, bool bigEndian) {
+    string out;
+    decode_utf16_into(data, size, bigEndian, out);
+    return out;
+}
+
+// Detects a byte order mark and stores the text as UTF-8 without the BOM
+template <class String>
+static void decode_input_into(const String& bytes, String& out) {
+    if (bytes.size() >= 3 && bytes.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        out.assign(bytes, 3, String::npos);
+    }
+    else if (bytes.size() >= 2 && bytes[0] == '\xFF' && bytes[1] == '\xFE') {
+        decode_utf16_into(bytes.data() + 2, bytes.size() - 2, false, out);
     }
+    else if (bytes.size() >= 2 && bytes[0] == '\xFE' && bytes[1] == '\xFF') {
+        decode_utf16_into(bytes.data() + 2, bytes.size() - 2, true, out);
+    }
+    else {
+        out = bytes;
+    }
+}
+
+string decode_input_text(const string& bytes) {
+    string out;
+    decode_input_into(bytes, out);
+    return out;
+}
+
 
-    string line;
-    while (getline(file, line)) {
-        lines.push_back(line);
+ // Reads lines from a given file into a vector of strings, allocating from the vector's allocator
+template <class Lines>
+static bool read_lines(const string& filename, Lines& lines, CheckBudget* budget = nullptr) {
+    using String = typename Lines::value_type;
+    ifstream file(filename, ios::binary);
+
+    if (!file.is_open()) {
+        return false;
     }
 
+    // Read the whole file at once so the encoding can be detected from its first bytes
+    String bytes(lines.get_allocator());
+    file.seekg(0, ios::end);
+    streamoff size = file.tellg();
+    file.seekg(0, ios::beg);
+    if (size > 0 && budget) {
+        // Oversized files are rejected before reading; the clock is checked per chunk
+        if (budget->spent(static_cast<size_t>(size))) {
+            return true;
+        }
+        bytes.reserve(static_cast<size_t>(size) + BUDGET_CHECK_INTERVAL);
+        size_t used = 0;
+        while (file) {
+            bytes.resize(used + BUDGET_CHECK_INTERVAL);
+            file.read(&bytes[used], BUDGET_CHECK_INTERVAL);
+            used += static_cast<size_t>(file.gcount());
+            if (budget->spent(used)) {
+                return true;
+            }
+        }
+        bytes.resize(used);
+    }
+    else if (size > 0) {
+        bytes.resize(static_cast<size_t>(size));
+        file.read(&bytes[0], size);
+        bytes.resize(static_cast<size_t>(file.gcount()));
+    }
     file.close();
+
+    String text(lines.get_allocator());
+    decode_input_into(bytes, text);
+
+    // Split into lines like getline() does, dropping the '\r' of CRLF endings
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        size_t next = end + 1;
+        if (end == String::npos) {
+            end = text.size();
+            next = end;
+        }
+        else if (end > pos && text[end - 1] == '\r') {
+            end--;
+        }
+        lines.emplace_back(text.data() + pos, end - pos);
+        pos = next;
+    }
+    return true;
+}
+
+vector<string> read_input_file(const string& filename, bool* opened, CheckBudget* budget) {
+    vector<string> lines;
+    bool ok = read_lines(filename, lines, budget);
+    if (opened) {
+        *opened = ok;
+    }
+    return lines;
+}
+
+pmr::vector<pmr::string> read_input_file(const string& filename, pmr::memory_resource* resource, bool* opened,
+    CheckBudget* budget) {
+    pmr::vector<pmr::string> lines(resource);
+    bool ok = read_lines(filename, lines, budget);
+    if (opened) {
+        *opened = ok;
+    }
     return lines;
 }
 
 
 // Validates code formatting: max number of lines, max line length, and no macro usage
-set<BracketError> code_validation(const vector<string>& lines) {
-    set<BracketError> errors;
+template <class Lines, class Errors>
+static void validate_lines(const Lines& lines, Errors& errors) {
     // Check for too many lines
-    if (lines.size() >= 1000) {
+    if (lines.size() >= MAX_PROGRAM_LINES) {
         errors.insert({ '\0', static_cast<int>(lines.size()), 1, TOO_LONG_PROGRAM });
-        return errors;
+        return;
     }
 
     for (size_t i = 0; i < lines.size(); i++) {
-        const string& line = lines[i];
+        const auto& line = lines[i];
         
         // Check for long lines
-        if (line.length() >= 1000) {
-            errors.insert({ '\0', static_cast<int>(i + 1), 1001, TOO_LONG_LINE });
+        if (line.length() >= MAX_LINE_LENGTH) {
+            errors.insert({ '\0', static_cast<int>(i + 1), static_cast<int>(MAX_LINE_LENGTH + 1), TOO_LONG_LINE });
         }
         // Check for usage of #define macros
         size_t pos = line.find("#define");
@@ -47,7 +210,17 @@ set<BracketError> code_validation(const vector<string>& lines) {
             errors.insert({ '#', static_cast<int>(i + 1), static_cast<int>(pos + 1), MACRO_USAGE });
         }
     }
+}
+
+set<BracketError> code_validation(const vector<string>& lines) {
+    set<BracketError> errors;
+    validate_lines(lines, errors);
+    return errors;
+}
 
+pmr::set<BracketError> code_validation(const pmr::vector<pmr::string>& lines, pmr::memory_resource* resource) {
+    pmr::set<BracketError> errors(resource);
+    validate_lines(lines, errors);
     return errors;
 }
 
@@ -67,125 +240,174 @@ inline bool isMatchingPair(char open, char close) {
 }
 
 
+// Parses brackets with the C/C++ rules of the original checker
 set<BracketError> parse_brackets(const vector<string>& lines) {
-    stack<pair<char, pair<int, int>>> bracketStack; // Stack stores (bracket, (line, column))
-    set<BracketError> errorPositions;
-    bool inBlockComment = false;
-
-    for (size_t lineNum = 0; lineNum < lines.size(); lineNum++) {
-        string line = lines[lineNum];
-        bool inLineComment = false;
-        bool inString = false;
-        char stringDelimiter = '\0';
-
-        for (size_t i = 0; i < line.size(); i++) {
-            char ch = line[i];
-            // Handle comments
-            if (i < line.size() - 1) {
-                if (!inBlockComment && line[i] == '/' && line[i + 1] == '/') {
-                    inLineComment = true; // Start of single-line comment
-                }
-                else if (!inLineComment && !inBlockComment && line[i] == '/' && line[i + 1] == '*') {
-                    inBlockComment = true; // Start of block comment
-                    i++; continue;
-                }
-                else if (inBlockComment && line[i] == '*' && line[i + 1] == '/') {
-                    inBlockComment = false; // End of block comment
-                    i++; continue;
-                }
-            }
+    return parse_brackets_as<CppLanguage>(lines);
+}
 
-            if (inBlockComment || inLineComment) continue;
+// Dispatches to the scanner specialised for the given language
+template <class Lines, class Allocator>
+static set<BracketError, less<BracketError>, Allocator> parse_brackets_for(const Lines& lines,
+    SourceLanguage language, BracketStructure* structure, const Allocator& alloc, CheckBudget* budget = nullptr,
+    int* maxDepth = nullptr) {
+    switch (language) {
+    case LANGUAGE_JSON:
+        return parse_brackets_as<JsonLanguage>(lines, structure, alloc, budget, maxDepth);
+    case LANGUAGE_JAVASCRIPT:
+        return parse_brackets_as<JavaScriptLanguage>(lines, structure, alloc, budget, maxDepth);
+    case LANGUAGE_PYTHON:
+        return parse_brackets_as<PythonLanguage>(lines, structure, alloc, budget, maxDepth);
+    case LANGUAGE_XML:
+        return parse_brackets_as<XmlLanguage>(lines, structure, alloc, budget, maxDepth);
+    case LANGUAGE_CPP:
+    default:
+        return parse_brackets_as<CppLanguage>(lines, structure, alloc, budget, maxDepth);
+    }
+}
 
-            // Handle strings
-            if (!inString && (ch == '"' || ch == '\'' || ch == '“' || ch == '”' || ch == '‘' || ch == '’')) {
-                inString = true;
-                if (ch == '“' || ch == '”') stringDelimiter = '"';
-                else if (ch == '‘' || ch == '’') stringDelimiter = '\'';
-                else stringDelimiter = ch;
-                continue;
-            }
-            else if (inString) {
-                if (ch == stringDelimiter) {
-                    int backslashes = 0;
-                    size_t j = i;
-                    while (j > 0 && line[--j] == '\\') {
-                        backslashes++;
-                    }
-                    if (backslashes % 2 == 0) {
-                        inString = false;
-                    }
-                }
-                continue;
-            }
+set<BracketError> parse_brackets(const vector<string>& lines, SourceLanguage language, CheckBudget* budget,
+    int* maxDepth) {
+    return parse_brackets_for(lines, language, nullptr, allocator<BracketError>(), budget, maxDepth);
+}
 
-            // Handle brackets
-            if (isOpeningBracket(ch)) {
-                bracketStack.push({ ch, {static_cast<int>(lineNum + 1), static_cast<int>(i + 1)} });
-            }
-            else if (isClosingBracket(ch)) {
-                if (!bracketStack.empty() && isMatchingPair(bracketStack.top().first, ch)) {
-                    bracketStack.pop();
-                }
-                else {  // Wrong closing bracket
-                    errorPositions.insert({ ch, static_cast<int>(lineNum + 1), static_cast<int>(i + 1), WRONG_BRACKET });
-                }
-            }
-        }
-    }
-    // Add remaining unmatched opening brackets
-    while (!bracketStack.empty()) {
-        auto top = bracketStack.top();
-        errorPositions.insert({ top.first, top.second.first, top.second.second, UNMATCHED_BRACKET });
-        bracketStack.pop();
+set<BracketError> parse_brackets(const vector<string>& lines, SourceLanguage language, BracketStructure& structure,
+    CheckBudget* budget) {
+    return parse_brackets_for(lines, language, &structure, allocator<BracketError>(), budget);
+}
+
+pmr::set<BracketError> parse_brackets(const pmr::vector<pmr::string>& lines, SourceLanguage language, pmr::memory_resource* resource,
+    CheckBudget* budget, int* maxDepth) {
+    return parse_brackets_for(lines, language, nullptr, pmr::polymorphic_allocator<BracketError>(resource), budget, maxDepth);
+}
+
+// Dispatches the balanced/unbalanced verdict to the scanner specialised for the given language
+template <class Lines, class Allocator>
+static bool brackets_balanced_for(const Lines& lines, SourceLanguage language, const Allocator& alloc,
+    CheckBudget* budget = nullptr, int* maxDepth = nullptr) {
+    switch (language) {
+    case LANGUAGE_JSON:
+        return brackets_balanced_as<JsonLanguage>(lines, alloc, budget, maxDepth);
+    case LANGUAGE_JAVASCRIPT:
+        return brackets_balanced_as<JavaScriptLanguage>(lines, alloc, budget, maxDepth);
+    case LANGUAGE_PYTHON:
+        return brackets_balanced_as<PythonLanguage>(lines, alloc, budget, maxDepth);
+    case LANGUAGE_XML:
+        return brackets_balanced_as<XmlLanguage>(lines, alloc, budget, maxDepth);
+    case LANGUAGE_CPP:
+    default:
+        return brackets_balanced_as<CppLanguage>(lines, alloc, budget, maxDepth);
     }
+}
 
-    return errorPositions;
+bool brackets_balanced(const vector<string>& lines, SourceLanguage language, CheckBudget* budget, int* maxDepth) {
+    return brackets_balanced_for(lines, language, allocator<char>(), budget, maxDepth);
 }
 
+bool brackets_balanced(const pmr::vector<pmr::string>& lines, SourceLanguage language, CheckBudget* budget, int* maxDepth) {
+    return brackets_balanced_for(lines, language, pmr::polymorphic_allocator<char>(lines.get_allocator().resource()),
+        budget, maxDepth);
+}
 
+// Per-thread arena: a monotonic resource over a buffer that is reused after each release
+namespace {
+    struct ThreadArena {
+        static const size_t INITIAL_SIZE = 1 << 20;
+        unique_ptr<char[]> buffer;
+        pmr::monotonic_buffer_resource resource;
 
+        ThreadArena() : buffer(new char[INITIAL_SIZE]), resource(buffer.get(), INITIAL_SIZE) {
+        }
+    };
 
+    ThreadArena& current_thread_arena() {
+        thread_local ThreadArena arena;
+        return arena;
+    }
+}
 
+pmr::memory_resource* thread_arena() {
+    return &current_thread_arena().resource;
+}
 
-// Writes the bracket and formatting errors to an output file
-void print_result(const string& outputFilename, const set<BracketError>& errors) {
-    ofstream outputFile(outputFilename);
-    if (!outputFile) {
-        cerr << "Error: Cannot open output file " << outputFilename << endl;
-        return;
+void release_thread_arena() {
+    current_thread_arena().resource.release();
+}
+
+// Maps a file extension to the language whose rules are used to check it
+bool language_from_extension(const string& filename, SourceLanguage& language) {
+    static const pair<const char*, SourceLanguage> extensions[] = {
+        { ".cpp", LANGUAGE_CPP }, { ".cc", LANGUAGE_CPP }, { ".cxx", LANGUAGE_CPP },
+        { ".c", LANGUAGE_CPP }, { ".h", LANGUAGE_CPP }, { ".hpp", LANGUAGE_CPP }, { ".inl", LANGUAGE_CPP },
+        { ".json", LANGUAGE_JSON },
+        { ".js", LANGUAGE_JAVASCRIPT }, { ".mjs", LANGUAGE_JAVASCRIPT },
+        { ".py", LANGUAGE_PYTHON },
+        { ".xml", LANGUAGE_XML }, { ".config", LANGUAGE_XML }
+    };
+
+    size_t dotPos = filename.rfind('.');
+    if (dotPos == string::npos) {
+        return false;
+    }
+    string extension = filename.substr(dotPos);
+    for (const auto& entry : extensions) {
+        if (extension == entry.first) {
+            language = entry.second;
+            return true;
+        }
     }
+    return false;
+}
+
+
+
 
+
+
+// Writes the bracket and formatting errors as the lines of a result file
+void write_result(ostream& out, const set<BracketError>& errors) {
     if (errors.empty()) {
-        outputFile << "All brackets are correctly closed." << endl;
+        out << "All brackets are correctly closed." << endl;
     }
     else {
-        outputFile << "Unmatched or invalid constructs found: " << endl;
+        out << "Unmatched or invalid constructs found: " << endl;
         for (const auto& error : errors) {
-            outputFile << "At Line " << error.line << ", Column " << error.column << ": ";
+            out << "At Line " << error.line << ", Column " << error.column << ": ";
 
             switch (error.type) {
             case WRONG_BRACKET:
-                outputFile << "Wrong closing bracket '" << error.bracket << "'.";
+                out << "Wrong closing bracket '" << error.bracket << "'.";
                 break;
             case UNMATCHED_BRACKET:
-                outputFile << "Unmatched opening bracket '" << error.bracket << "'.";
+                out << "Unmatched opening bracket '" << error.bracket << "'.";
                 break;
             case TOO_LONG_PROGRAM:
-                outputFile << "Too many lines in the program.";
+                out << "Too many lines in the program.";
                 break;
             case TOO_LONG_LINE:
-                outputFile << "Line exceeds maximum length.";
+                out << "Line exceeds maximum length.";
                 break;
             case MACRO_USAGE:
-                outputFile << "Usage of #define is not allowed.";
+                out << "Usage of #define is not allowed.";
+                break;
+            case BUDGET_EXCEEDED:
+                out << "Check stopped: time or size budget exceeded.";
                 break;
             }
 
-            outputFile << endl;
+            out << endl;
         }
     }
+}
+
+// Writes the bracket and formatting errors to an output file
+bool print_result(const string& outputFilename, const set<BracketError>& errors) {
+    ofstream outputFile(outputFilename);
+    if (!outputFile) {
+        return false;
+    }
 
+    write_result(outputFile, errors);
     outputFile.close();
+    return true;
 }
 
@@ -8,6 +8,7 @@
  *
  * @section features Features
  * - Checks for correct bracket pairing and nesting.
+ * - Supports C/C++, JSON, JavaScript, Python and XML rules, selected by file extension.
  * - Validates line limits (max 1000 lines) and line length (max 1000 characters).
  * - Disallows usage of `#define` macros.
  * - Outputs structured error reports.
@@ -44,6 +45,11 @@
 #include <vector>
 #include <set>
 #include <tuple>
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <chrono>
+#include <stop_token>
 
 
 
@@ -65,11 +71,33 @@ enum BracketErrorType {
     UNMATCHED_BRACKET, ///< Unmatched opening bracket
     TOO_LONG_PROGRAM,  ///< File has more than 1000 lines
     TOO_LONG_LINE, ///< A single line exceeds 1000 characters
-    MACRO_USAGE   ///< `#define` macro used in code
+    MACRO_USAGE,  ///< `#define` macro used in code
+    BUDGET_EXCEEDED ///< Check stopped because its time or byte budget ran out
 
 };
 
 
+/// Programs with this many lines or more are rejected (TOO_LONG_PROGRAM).
+const size_t MAX_PROGRAM_LINES = 1000;
+/// Lines with this many characters or more are rejected (TOO_LONG_LINE).
+const size_t MAX_LINE_LENGTH = 1000;
+/// Readers and the scanner test a CheckBudget once per this many bytes.
+const size_t BUDGET_CHECK_INTERVAL = 65536;
+
+
+/**
+ * @enum SourceLanguage
+ * @brief Languages whose bracket, comment and string rules are known to the checker.
+ */
+enum SourceLanguage {
+    LANGUAGE_CPP,        ///< C and C++ (the default)
+    LANGUAGE_JSON,       ///< JSON documents
+    LANGUAGE_JAVASCRIPT, ///< JavaScript, including template literals
+    LANGUAGE_PYTHON,     ///< Python, including triple-quoted strings
+    LANGUAGE_XML         ///< XML-like configs with angle brackets
+};
+
+
 /**
  * @struct BracketError
  * @brief Struct to hold details about a bracket or formatting error.
@@ -89,6 +117,86 @@ struct BracketError
 };
 
 
+/**
+ * @struct CheckBudget
+ * @brief Time and byte limits for checking one file.
+ *
+ * Functions taking a budget test it every BUDGET_CHECK_INTERVAL bytes, so a
+ * pathological input cannot stall a batch, and test the nesting depth at
+ * every opening bracket, so it cannot grow the bracket stack without bound.
+ * Once the budget is spent they stop, set @c exceeded and report a single
+ * BUDGET_EXCEEDED error.
+ */
+struct CheckBudget {
+    size_t maxBytes = 0;  ///< Largest input in bytes; 0 means no limit
+    size_t maxDepth = 0;  ///< Deepest bracket nesting, bounding the bracket stack; 0 means no limit
+    chrono::milliseconds timeout{ 0 };  ///< Time allowed for each check from start(); 0 means no limit
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+    stop_token stop;      ///< Cooperative cancellation by the caller
+    bool exceeded = false; ///< Set by the first check that ran out of budget
+
+    /**
+     * @brief Tests the budget after @p bytes of input have been processed.
+     * @return True if the check has to stop; @c exceeded is set as well.
+     */
+    bool spent(size_t bytes) {
+        if ((maxBytes != 0 && bytes > maxBytes) || stop.stop_requested() ||
+            (deadline != chrono::steady_clock::time_point::max() && chrono::steady_clock::now() >= deadline)) {
+            exceeded = true;
+        }
+        return exceeded;
+    }
+
+    /**
+     * @brief Starts the timeout of a check; called on a fresh copy of the budget for each file.
+     */
+    void start() {
+        if (timeout.count() > 0) {
+            deadline = chrono::steady_clock::now() + timeout;
+        }
+    }
+};
+
+
+
+/**
+ * @struct FoldingRange
+ * @brief Lines spanned by a bracket pair, usable as an editor folding range.
+ */
+struct FoldingRange {
+    int startLine; ///< Line of the opening bracket
+    int endLine;   ///< Line of the closing bracket
+};
+
+
+/**
+ * @struct BracketStructure
+ * @brief Matching bracket pairs of a file, stored as structure of arrays.
+ *
+ * Entry k of each pair array describes the same pair; pairs are listed in
+ * the order their closing brackets appear.
+ */
+struct BracketStructure {
+    vector<int> openLine;       ///< Line of the opening bracket
+    vector<int> openColumn;     ///< Column of the opening bracket
+    vector<int> closeLine;      ///< Line of the closing bracket
+    vector<int> closeColumn;    ///< Column of the closing bracket
+    vector<int> depth;          ///< Nesting depth of the pair, 1 for top level
+    vector<FoldingRange> foldingRanges; ///< Multi-line pairs, one per start line, by start line
+    int maxDepth = 0;           ///< Deepest nesting reached in the file
+
+    /// Removes all pairs and ranges, keeping the allocated capacity.
+    void clear() {
+        openLine.clear();
+        openColumn.clear();
+        closeLine.clear();
+        closeColumn.clear();
+        depth.clear();
+        foldingRanges.clear();
+        maxDepth = 0;
+    }
+};
+
 
 /**
  * @brief Checks whether a character is an opening bracket.
@@ -114,12 +222,77 @@ inline bool isClosingBracket(char ch);
 inline bool isMatchingPair(char open, char close);
 
 
+/**
+ * @brief Converts UTF-16 text to UTF-8.
+ *
+ * Surrogate pairs are combined; unpaired surrogates become U+FFFD.
+ * @param data [in] Pointer to the UTF-16 bytes (without BOM).
+ * @param size [in] Number of bytes; a trailing odd byte is ignored.
+ * @param bigEndian [in] True for UTF-16BE, false for UTF-16LE.
+ * @return The text encoded as UTF-8.
+ */
+string decode_utf16_to_utf8(const char* data, size_t size, bool bigEndian);
+
+
+/**
+ * @brief Converts UTF-16 text to UTF-8 into an existing string.
+ *
+ * Same as decode_utf16_to_utf8(const char*, size_t, bool), but reuses the
+ * capacity of @p out instead of allocating a new string.
+ * @param data [in] Pointer to the UTF-16 bytes (without BOM).
+ * @param size [in] Number of bytes; a trailing odd byte is ignored.
+ * @param bigEndian [in] True for UTF-16BE, false for UTF-16LE.
+ * @param out [out] Receives the text encoded as UTF-8.
+ */
+void decode_utf16_to_utf8(const char* data, size_t size, bool bigEndian, string& out);
+
+
+/**
+ * @brief Converts UTF-16 text to UTF-8 into an existing allocator-aware string.
+ * @param data [in] Pointer to the UTF-16 bytes (without BOM).
+ * @param size [in] Number of bytes; a trailing odd byte is ignored.
+ * @param bigEndian [in] True for UTF-16BE, false for UTF-16LE.
+ * @param out [out] Receives the text encoded as UTF-8, allocated from its own resource.
+ */
+void decode_utf16_to_utf8(const char* data, size_t size, bool bigEndian, pmr::string& out);
+
+
+/**
+ * @brief Detects the byte order mark of raw file contents.
+ *
+ * A UTF-8 BOM is stripped, UTF-16LE/BE input (with BOM) is transcoded to UTF-8,
+ * anything else is returned unchanged.
+ * @param bytes [in] Raw file contents.
+ * @return The text as UTF-8 without BOM.
+ */
+string decode_input_text(const string& bytes);
+
+
 /**
  * @brief Reads all lines from a file.
+ *
+ * The file encoding is detected from its BOM (see decode_input_text()).
+ * Nothing is printed; a file that cannot be opened yields no lines.
+ * With a budget the file is read in BUDGET_CHECK_INTERVAL chunks; a file
+ * over budget also yields no lines and sets budget->exceeded.
+ * @param filename [in] Path to the input file.
+ * @param opened [out] Optional; set to false if the file cannot be opened.
+ * @param budget [in,out] Optional time and byte budget.
+ * @return Vector containing each line as a string.
+ */
+vector<string> read_input_file(const string& filename, bool* opened = nullptr, CheckBudget* budget = nullptr);
+
+
+/**
+ * @brief Reads all lines from a file into memory from the given resource.
  * @param filename [in] Path to the input file.
+ * @param resource [in] Memory resource for the vector and every line.
+ * @param opened [out] Optional; set to false if the file cannot be opened.
+ * @param budget [in,out] Optional time and byte budget, as for the std::string overload.
  * @return Vector containing each line as a string.
  */
-vector<string> read_input_file(const string& filename);
+pmr::vector<pmr::string> read_input_file(const string& filename, pmr::memory_resource* resource, bool* opened = nullptr,
+    CheckBudget* budget = nullptr);
 
 
 /**
@@ -132,6 +305,15 @@ vector<string> read_input_file(const string& filename);
 set<BracketError> code_validation(const vector<string>& lines);
 
 
+/**
+ * @brief Validates program constraints, allocating from the given resource.
+ * @param lines [in] Source code lines to validate.
+ * @param resource [in] Memory resource for the result set.
+ * @return Set of bracket errors related to formatting.
+ */
+pmr::set<BracketError> code_validation(const pmr::vector<pmr::string>& lines, pmr::memory_resource* resource);
+
+
 /**
  * @brief Parses brackets in the source code.
  * @param lines [in] Validated source code lines.
@@ -140,12 +322,115 @@ set<BracketError> code_validation(const vector<string>& lines);
 set<BracketError> parse_brackets(const vector<string>& lines);
 
 
+/**
+ * @brief Parses brackets using the rules of the given language.
+ * @param lines [in] Validated source code lines.
+ * @param language [in] Language of the source.
+ * @param budget [in,out] Optional budget; when it runs out the result is a
+ *        single BUDGET_EXCEEDED error at the position reached.
+ * @param maxDepth [in,out] Optional; raised to the deepest bracket nesting reached.
+ * @return Set of bracket errors (wrong or unmatched).
+ */
+set<BracketError> parse_brackets(const vector<string>& lines, SourceLanguage language, CheckBudget* budget = nullptr,
+    int* maxDepth = nullptr);
+
+
+/**
+ * @brief Parses brackets and records the bracket structure in the same pass.
+ * @param lines [in] Validated source code lines.
+ * @param language [in] Language of the source.
+ * @param structure [out] Matching pairs, folding ranges and maximum depth.
+ * @param budget [in,out] Optional; when it runs out the result is a single BUDGET_EXCEEDED error.
+ * @return Set of bracket errors (wrong or unmatched).
+ */
+set<BracketError> parse_brackets(const vector<string>& lines, SourceLanguage language, BracketStructure& structure,
+    CheckBudget* budget = nullptr);
+
+
+/**
+ * @brief Parses brackets, allocating the stack and the result from the given resource.
+ * @param lines [in] Validated source code lines.
+ * @param language [in] Language of the source.
+ * @param resource [in] Memory resource for the bracket stack and the result set.
+ * @param budget [in,out] Optional; when it runs out the result is a single BUDGET_EXCEEDED error.
+ * @param maxDepth [in,out] Optional; raised to the deepest bracket nesting reached.
+ * @return Set of bracket errors (wrong or unmatched).
+ */
+pmr::set<BracketError> parse_brackets(const pmr::vector<pmr::string>& lines, SourceLanguage language, pmr::memory_resource* resource,
+    CheckBudget* budget = nullptr, int* maxDepth = nullptr);
+
+
+/**
+ * @brief Fast check whether all brackets are balanced.
+ *
+ * Same verdict as `parse_brackets(lines, language).empty()` without recording
+ * positions or errors. Use parse_brackets() to localise errors when it returns false.
+ * @param lines [in] Validated source code lines.
+ * @param language [in] Language of the source.
+ * @param budget [in,out] Optional budget; false is returned when it runs out.
+ * @param maxDepth [in,out] Optional; raised to the deepest bracket nesting reached before the scan ended.
+ * @return True if there are no wrong or unmatched brackets.
+ */
+bool brackets_balanced(const vector<string>& lines, SourceLanguage language, CheckBudget* budget = nullptr,
+    int* maxDepth = nullptr);
+
+
+/**
+ * @brief Fast balanced check; the bracket stack is allocated from the resource of @p lines.
+ * @param lines [in] Validated source code lines.
+ * @param language [in] Language of the source.
+ * @param budget [in,out] Optional budget; false is returned when it runs out.
+ * @param maxDepth [in,out] Optional; raised to the deepest bracket nesting reached before the scan ended.
+ * @return True if there are no wrong or unmatched brackets.
+ */
+bool brackets_balanced(const pmr::vector<pmr::string>& lines, SourceLanguage language, CheckBudget* budget = nullptr,
+    int* maxDepth = nullptr);
+
+
+/**
+ * @brief Per-thread arena for batch processing.
+ *
+ * A monotonic resource over a buffer owned by the calling thread. Allocations
+ * are never freed individually; call release_thread_arena() after each file
+ * to make the whole buffer available again. Only touched by its own thread,
+ * so there is no allocator contention between workers.
+ * @return The arena of the calling thread.
+ */
+pmr::memory_resource* thread_arena();
+
+
+/**
+ * @brief Frees everything allocated from the calling thread's arena at once.
+ *
+ * All containers allocated from thread_arena() must be destroyed first.
+ */
+void release_thread_arena();
+
+
+/**
+ * @brief Selects the language of a file from its extension.
+ * @param filename [in] Path of the file.
+ * @param language [out] Detected language, unchanged if the extension is unknown.
+ * @return True if the extension is supported.
+ */
+bool language_from_extension(const string& filename, SourceLanguage& language);
+
+
+/**
+ * @brief Writes errors in the format of the result file.
+ * @param out [in,out] Destination stream.
+ * @param errors [in] Set of errors to write.
+ */
+void write_result(ostream& out, const set<BracketError>& errors);
+
+
 /**
  * @brief Prints errors to an output file.
  * @param outputFilename [in] Path to output result file.
  * @param errors [in] Set of errors to write.
+ * @return False if the output file cannot be opened.
  */
-void print_result(const string& outputFilename, const set<BracketError>& errors);
+bool print_result(const string& outputFilename, const set<BracketError>& errors);
 
 
 
@@ -0,0 +1,125 @@
+/**
+ * @file BracketCheckerC.cpp
+ * @brief C interface over BracketChecker; no exception crosses the boundary.
+ */
+#include "BracketCheckerC.h"
+#include "BracketCheckerEngine.h"
+
+
+/// Handle behind the opaque C type: the checker and the exported error array.
+struct bc_checker {
+    BracketChecker checker;
+    vector<bc_error> errors;
+
+    explicit bc_checker(SourceLanguage language) : checker(language) {
+    }
+};
+
+
+// Converts a C language value, rejecting unknown values
+static bool to_language(int value, SourceLanguage& language) {
+    if (value < BC_LANGUAGE_CPP || value > BC_LANGUAGE_XML) {
+        return false;
+    }
+    language = static_cast<SourceLanguage>(value);
+    return true;
+}
+
+// Copies the checker's errors into the exported array
+static int export_errors(bc_checker* handle) {
+    const auto& errors = handle->checker.errors();
+    handle->errors.resize(errors.size());
+    for (size_t i = 0; i < errors.size(); i++) {
+        handle->errors[i] = { static_cast<int>(errors[i].type), errors[i].line, errors[i].column, errors[i].bracket };
+    }
+    return static_cast<int>(errors.size());
+}
+
+
+int bc_api_version(void) {
+    return BC_API_VERSION;
+}
+
+bc_checker* bc_create(int language) {
+    SourceLanguage value;
+    if (!to_language(language, value)) {
+        return nullptr;
+    }
+    try {
+        return new bc_checker(value);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void bc_destroy(bc_checker* checker) {
+    delete checker;
+}
+
+int bc_set_language(bc_checker* checker, int language) {
+    SourceLanguage value;
+    if (!checker || !to_language(language, value)) {
+        return -1;
+    }
+    checker->checker.set_language(value);
+    return 0;
+}
+
+int bc_check_buffer(bc_checker* checker, const char* data, size_t size) {
+    if (!checker || (!data && size > 0)) {
+        return -1;
+    }
+    try {
+        checker->checker.check(string_view(data ? data : "", size));
+        return export_errors(checker);
+    }
+    catch (...) {
+        checker->errors.clear();
+        return -1;
+    }
+}
+
+int bc_check_file(bc_checker* checker, const char* path) {
+    if (!checker || !path) {
+        return -1;
+    }
+    try {
+        if (!checker->checker.check_file(path)) {
+            checker->errors.clear();
+            return -1;
+        }
+        return export_errors(checker);
+    }
+    catch (...) {
+        checker->errors.clear();
+        return -1;
+    }
+}
+
+const bc_error* bc_errors(const bc_checker* checker) {
+    return checker && !checker->errors.empty() ? checker->errors.data() : nullptr;
+}
+
+size_t bc_error_count(const bc_checker* checker) {
+    return checker ? checker->errors.size() : 0;
+}
+
+const char* bc_error_description(int type) {
+    switch (type) {
+    case BC_WRONG_BRACKET:
+        return "Wrong closing bracket";
+    case BC_UNMATCHED_BRACKET:
+        return "Unmatched opening bracket";
+    case BC_TOO_LONG_PROGRAM:
+        return "Too many lines in the program";
+    case BC_TOO_LONG_LINE:
+        return "Line exceeds maximum length";
+    case BC_MACRO_USAGE:
+        return "Usage of #define is not allowed";
+    case BC_BUDGET_EXCEEDED:
+        return "Time or size budget exceeded";
+    default:
+        return "Unknown error";
+    }
+}
@@ -0,0 +1,126 @@
+/**
+ * @file BracketCheckerC.h
+ * @brief Stable C interface of the BracketChecker2 shared library.
+ *
+ * Lets other runtimes (Python ctypes/cffi, Go cgo, Rust FFI, ...) check
+ * buffers in-process instead of spawning BracketChecker2 and parsing
+ * result.txt. Each handle owns a BracketChecker with its scratch memory.
+ *
+ * Thread safety: distinct handles may be used concurrently from different
+ * threads; a single handle must not be used by two threads at once.
+ * The library never prints to stdout or stderr.
+ *
+ * @code
+ * bc_checker* checker = bc_create(BC_LANGUAGE_CPP);
+ * int count = bc_check_buffer(checker, text, length);
+ * const bc_error* errors = bc_errors(checker);
+ * for (int i = 0; i < count; i++) { ... errors[i].line ... }
+ * bc_destroy(checker);
+ * @endcode
+ */
+
+#ifndef BRACKETCHECKERC_H
+#define BRACKETCHECKERC_H
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#  if defined(BRACKETCHECKER_EXPORTS)
+#    define BC_API __declspec(dllexport)
+#  elif defined(BRACKETCHECKER_STATIC)
+#    define BC_API
+#  else
+#    define BC_API __declspec(dllimport)
+#  endif
+#else
+#  define BC_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Version of this interface; changes only when the ABI changes. */
+#define BC_API_VERSION 1
+
+/** @brief Opaque checker handle. */
+typedef struct bc_checker bc_checker;
+
+/** @brief Language rules, same values as SourceLanguage. */
+enum bc_language {
+    BC_LANGUAGE_CPP = 0,
+    BC_LANGUAGE_JSON = 1,
+    BC_LANGUAGE_JAVASCRIPT = 2,
+    BC_LANGUAGE_PYTHON = 3,
+    BC_LANGUAGE_XML = 4
+};
+
+/** @brief Error kinds, same values as BracketErrorType. */
+enum bc_error_type {
+    BC_WRONG_BRACKET = 0,
+    BC_UNMATCHED_BRACKET = 1,
+    BC_TOO_LONG_PROGRAM = 2,
+    BC_TOO_LONG_LINE = 3,
+    BC_MACRO_USAGE = 4,
+    BC_BUDGET_EXCEEDED = 5
+};
+
+/** @brief One error of the last check. */
+typedef struct bc_error {
+    int type;      /**< One of bc_error_type */
+    int line;      /**< 1-based line */
+    int column;    /**< 1-based column */
+    char bracket;  /**< Offending bracket, '#' for macros, 0 otherwise */
+} bc_error;
+
+/** @brief Returns BC_API_VERSION of the loaded library. */
+BC_API int bc_api_version(void);
+
+/**
+ * @brief Creates a checker.
+ * @param language One of bc_language.
+ * @return New handle, or NULL if out of memory or the language is unknown.
+ */
+BC_API bc_checker* bc_create(int language);
+
+/** @brief Destroys a handle; NULL is ignored. */
+BC_API void bc_destroy(bc_checker* checker);
+
+/**
+ * @brief Changes the language rules of a handle.
+ * @return 0 on success, -1 if the language is unknown.
+ */
+BC_API int bc_set_language(bc_checker* checker, int language);
+
+/**
+ * @brief Checks an in-memory buffer (UTF-8, or UTF-16 with BOM).
+ * @return Number of errors, or -1 on failure.
+ */
+BC_API int bc_check_buffer(bc_checker* checker, const char* data, size_t size);
+
+/**
+ * @brief Reads and checks a file.
+ * @return Number of errors, or -1 if the file cannot be read.
+ */
+BC_API int bc_check_file(bc_checker* checker, const char* path);
+
+/**
+ * @brief Errors of the last check, sorted by line and column.
+ * @return Array of bc_error_count() entries, valid until the next call on the handle.
+ */
+BC_API const bc_error* bc_errors(const bc_checker* checker);
+
+/** @brief Number of errors of the last check. */
+BC_API size_t bc_error_count(const bc_checker* checker);
+
+/**
+ * @brief Describes an error type, e.g. "Wrong closing bracket".
+ * @return Static string, never NULL.
+ */
+BC_API const char* bc_error_description(int type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BRACKETCHECKERC_H */
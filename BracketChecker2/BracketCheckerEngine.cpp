@@ -0,0 +1,232 @@
+/**
+ * @file BracketCheckerEngine.cpp
+ * @brief Implementation of the reusable BracketChecker object.
+ */
+#include "BracketCheckerEngine.h"
+#include "BracketLanguages.h"
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+
+BracketChecker::BracketChecker(SourceLanguage language, pmr::memory_resource* resource)
+    : language(language), fileBuffer(resource), decodeBuffer(resource), lines(resource),
+      bracketStack(resource), errorList(resource) {
+}
+
+void BracketChecker::set_language(SourceLanguage newLanguage) {
+    language = newLanguage;
+}
+
+// Builds the line index like read_input_file() splits lines
+void BracketChecker::split_lines(string_view text) {
+    lines.clear();
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        size_t next = end + 1;
+        if (end == string_view::npos) {
+            end = text.size();
+            next = end;
+        }
+        else if (end > pos && text[end - 1] == '\r') {
+            end--;
+        }
+        lines.push_back(text.substr(pos, end - pos));
+        pos = next;
+    }
+}
+
+// Applies the rules of code_validation() to the line index
+bool BracketChecker::validate() {
+    if (lines.size() >= MAX_PROGRAM_LINES) {
+        errorList.push_back({ '\0', static_cast<int>(lines.size()), 1, TOO_LONG_PROGRAM });
+        return false;
+    }
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (lines[i].length() >= MAX_LINE_LENGTH) {
+            errorList.push_back({ '\0', static_cast<int>(i + 1), static_cast<int>(MAX_LINE_LENGTH + 1), TOO_LONG_LINE });
+        }
+        size_t pos = lines[i].find("#define");
+        if (pos != string_view::npos) {
+            errorList.push_back({ '#', static_cast<int>(i + 1), static_cast<int>(pos + 1), MACRO_USAGE });
+        }
+    }
+    return errorList.empty();
+}
+
+// Runs the scanner of one language with the owned stack and error list
+template <class Language>
+void BracketChecker::scan(CheckBudget* budget) {
+    struct Sink {
+        pmr::vector<StackEntry>& bracketStack;
+        pmr::vector<BracketError>& errorList;
+        int& maxDepth;
+
+        void open(char ch, int line, int column) {
+            bracketStack.push_back({ ch, line, column });
+            if (static_cast<int>(bracketStack.size()) > maxDepth) {
+                maxDepth = static_cast<int>(bracketStack.size());
+            }
+        }
+
+        bool close(char ch, char opener, int line, int column) {
+            if (!bracketStack.empty() && bracketStack.back().bracket == opener) {
+                bracketStack.pop_back();
+            }
+            else {  // Wrong closing bracket
+                errorList.push_back({ ch, line, column, WRONG_BRACKET });
+            }
+            return true;
+        }
+
+        void budget_exceeded(int line, int column) {
+            errorList.clear();
+            errorList.push_back({ '\0', line, column, BUDGET_EXCEEDED });
+        }
+
+        size_t depth() const {
+            return bracketStack.size();
+        }
+    };
+
+    Sink sink = { bracketStack, errorList, maxDepth };
+    if (!scan_brackets<Language>(lines, sink, budget)) {
+        return;
+    }
+
+    // Remaining opening brackets are unmatched
+    for (const StackEntry& entry : bracketStack) {
+        errorList.push_back({ entry.bracket, entry.line, entry.column, UNMATCHED_BRACKET });
+    }
+}
+
+const pmr::vector<BracketError>& BracketChecker::check(string_view source, CheckBudget* budget) {
+    errorList.clear();
+    bracketStack.clear();
+    maxDepth = 0;
+    if (budget && budget->spent(source.size())) {
+        lines.clear();
+        errorList.push_back({ '\0', 1, 1, BUDGET_EXCEEDED });
+        return errorList;
+    }
+
+    // Detect the encoding like decode_input_text() does
+    if (source.size() >= 3 && source.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        source.remove_prefix(3);
+    }
+    else if (source.size() >= 2 && source[0] == '\xFF' && source[1] == '\xFE') {
+        decode_utf16_to_utf8(source.data() + 2, source.size() - 2, false, decodeBuffer);
+        source = decodeBuffer;
+    }
+    else if (source.size() >= 2 && source[0] == '\xFE' && source[1] == '\xFF') {
+        decode_utf16_to_utf8(source.data() + 2, source.size() - 2, true, decodeBuffer);
+        source = decodeBuffer;
+    }
+
+    split_lines(source);
+    if (!validate()) {
+        sort(errorList.begin(), errorList.end());
+        return errorList;
+    }
+
+    switch (language) {
+    case LANGUAGE_JSON:
+        scan<JsonLanguage>(budget);
+        break;
+    case LANGUAGE_JAVASCRIPT:
+        scan<JavaScriptLanguage>(budget);
+        break;
+    case LANGUAGE_PYTHON:
+        scan<PythonLanguage>(budget);
+        break;
+    case LANGUAGE_XML:
+        scan<XmlLanguage>(budget);
+        break;
+    case LANGUAGE_CPP:
+    default:
+        scan<CppLanguage>(budget);
+        break;
+    }
+
+    sort(errorList.begin(), errorList.end());
+    return errorList;
+}
+
+bool BracketChecker::check_file(const string& path, CheckBudget* budget) {
+    errorList.clear();
+    lines.clear();
+    maxDepth = 0;
+
+    // Low-level I/O: unlike ifstream it does not allocate a stream buffer per file
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+#endif
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t used = 0;
+    bool overBudget = false;
+    bool readError = false;
+    // Grown as the file is read, within the capacity kept from earlier files; filling the
+    // whole capacity up front would cost as much as the largest file so far
+    fileBuffer.clear();
+    while (true) {
+        if (used == fileBuffer.size()) {
+            fileBuffer.resize(fileBuffer.size() < 65536 ? 65536 : 2 * fileBuffer.size());
+        }
+        // With a budget every read is one check interval, so a slow source is noticed
+        size_t request = fileBuffer.size() - used;
+        if (budget && request > BUDGET_CHECK_INTERVAL) {
+            request = BUDGET_CHECK_INTERVAL;
+        }
+#ifdef _WIN32
+        int count = _read(fd, &fileBuffer[used], static_cast<unsigned>(request));
+#else
+        ssize_t count = ::read(fd, &fileBuffer[used], request);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+#endif
+        if (count < 0) {
+            readError = true;
+            break;
+        }
+        if (count == 0) {
+            break;
+        }
+        used += static_cast<size_t>(count);
+        if (budget && budget->spent(used)) {
+            overBudget = true;
+            break;
+        }
+    }
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+
+    // A failed read would otherwise pass a truncated file as checked
+    if (readError) {
+        fileBuffer.clear();
+        return false;
+    }
+    if (overBudget) {
+        fileBuffer.clear();
+        errorList.push_back({ '\0', 1, 1, BUDGET_EXCEEDED });
+        return true;
+    }
+    fileBuffer.resize(used);
+    check(fileBuffer, budget);
+    return true;
+}
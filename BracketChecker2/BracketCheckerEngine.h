@@ -0,0 +1,103 @@
+/**
+ * @file BracketCheckerEngine.h
+ * @brief Reusable checker object for long-running processes.
+ *
+ * The free functions in BracketChecker2.h allocate fresh containers on every
+ * call. BracketChecker owns its input buffer, line index, bracket stack and
+ * error list and only clears them between checks, so once the buffers have
+ * grown to the size of the largest input no further heap allocation happens.
+ * All buffers are allocated from the memory resource given at construction.
+ */
+
+#pragma once
+#ifndef BRACKETCHECKERENGINE_H
+#define BRACKETCHECKERENGINE_H
+
+#include <string_view>
+#include "BracketChecker2.h"
+
+
+/**
+ * @class BracketChecker
+ * @brief Validates and parses buffers or files, reusing its memory between calls.
+ *
+ * A check runs the same pipeline as the command-line program: code_validation()
+ * rules first, and parse_brackets() rules only if validation passed. Errors are
+ * returned sorted in the order of set<BracketError>.
+ *
+ * An instance is not thread-safe; use one instance per thread.
+ */
+class BracketChecker {
+public:
+    /**
+     * @brief Creates a checker.
+     * @param language [in] Language rules used by check() and check_file().
+     * @param resource [in] Memory resource for all buffers owned by the checker.
+     */
+    explicit BracketChecker(SourceLanguage language = LANGUAGE_CPP,
+        pmr::memory_resource* resource = pmr::get_default_resource());
+
+    /**
+     * @brief Selects the language rules for the next checks.
+     * @param language [in] Language of the following inputs.
+     */
+    void set_language(SourceLanguage language);
+
+    /**
+     * @brief Checks an in-memory buffer.
+     *
+     * The buffer is decoded like read_input_file() does (BOM detection, CRLF).
+     * @param source [in] File contents; only read during the call.
+     * @param budget [in,out] Optional; when it runs out the errors are a single BUDGET_EXCEEDED.
+     * @return Sorted errors, valid until the next check.
+     */
+    const pmr::vector<BracketError>& check(string_view source, CheckBudget* budget = nullptr);
+
+    /**
+     * @brief Reads and checks a file.
+     * @param path [in] Path to the input file.
+     * @param budget [in,out] Optional; also tested after every BUDGET_CHECK_INTERVAL bytes read.
+     * @return False if the file cannot be opened or read; errors() is then empty.
+     */
+    bool check_file(const string& path, CheckBudget* budget = nullptr);
+
+    /**
+     * @brief Errors of the last check.
+     * @return Sorted errors, valid until the next check.
+     */
+    const pmr::vector<BracketError>& errors() const { return errorList; }
+
+    /**
+     * @brief Number of lines of the last checked input.
+     */
+    size_t line_count() const { return lines.size(); }
+
+    /**
+     * @brief Deepest bracket nesting reached by the last check.
+     */
+    int max_depth() const { return maxDepth; }
+
+private:
+    /// Opening bracket waiting for its partner.
+    struct StackEntry {
+        char bracket;
+        int line;
+        int column;
+    };
+
+    template <class Language>
+    void scan(CheckBudget* budget);
+    void split_lines(string_view text);
+    bool validate();
+
+    SourceLanguage language;
+    pmr::string fileBuffer;           ///< Raw bytes of the last file read by check_file()
+    pmr::string decodeBuffer;         ///< UTF-8 text of a UTF-16 input
+    pmr::vector<string_view> lines;   ///< Line index into the current input
+    pmr::vector<StackEntry> bracketStack;
+    pmr::vector<BracketError> errorList;
+    int maxDepth = 0;
+};
+
+
+#endif // BRACKETCHECKERENGINE_H
@@ -0,0 +1,549 @@
+/**
+ * @file BracketLanguages.h
+ * @brief Language policies and the templated bracket scanner.
+ *
+ * Each policy describes the bracket alphabet, comment syntax and string
+ * syntax of one language. parse_brackets_as() is instantiated once per
+ * policy; the policy is turned into a 256-entry classification table at
+ * compile time, so the byte loop does a single table lookup per character
+ * and never consults runtime flags. The same scan feeds either the error
+ * collecting sink or the cheaper balanced/unbalanced verdict sink.
+ */
+
+#pragma once
+#ifndef BRACKETLANGUAGES_H
+#define BRACKETLANGUAGES_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "BracketChecker2.h"
+
+
+/**
+ * @brief Character classes stored in a language classification table.
+ */
+enum CharClass : unsigned char {
+    CHAR_OPEN = 1,           ///< Opening bracket
+    CHAR_CLOSE = 2,          ///< Closing bracket
+    CHAR_QUOTE = 4,          ///< Starts or ends a string literal
+    CHAR_LINE_COMMENT = 8,   ///< First character of the line comment marker
+    CHAR_BLOCK_OPEN = 16,    ///< First character of the block comment opener
+    CHAR_BLOCK_CLOSE = 32    ///< First character of the block comment closer
+};
+
+
+/**
+ * @struct CppLanguage
+ * @brief C and C++ sources. This is the behaviour of the original checker.
+ *
+ * Comment markers are recognised even inside string literals. Only ASCII
+ * quotes open strings: the original checker compared each byte with the
+ * multi-character constants of the curly quotes, which no single byte can
+ * equal, so UTF-8 curly quotes have always been ordinary text.
+ */
+struct CppLanguage {
+    static constexpr const char* brackets = "()[]{}";
+    static constexpr const char* lineComment = "//";
+    static constexpr const char* blockCommentOpen = "/*";
+    static constexpr const char* blockCommentClose = "*/";
+    static constexpr const char* multiLineQuotes = "";
+    static constexpr bool tripleQuotes = false;
+    static constexpr bool commentsInsideStrings = true;
+
+    static constexpr char quote_delimiter(char ch) {
+        return (ch == '"' || ch == '\'') ? ch : '\0';
+    }
+};
+
+/**
+ * @struct JsonLanguage
+ * @brief JSON documents: no comments, double-quoted strings only.
+ */
+struct JsonLanguage {
+    static constexpr const char* brackets = "[]{}";
+    static constexpr const char* lineComment = "";
+    static constexpr const char* blockCommentOpen = "";
+    static constexpr const char* blockCommentClose = "";
+    static constexpr const char* multiLineQuotes = "";
+    static constexpr bool tripleQuotes = false;
+    static constexpr bool commentsInsideStrings = false;
+
+    static constexpr char quote_delimiter(char ch) {
+        return ch == '"' ? ch : '\0';
+    }
+};
+
+/**
+ * @struct JavaScriptLanguage
+ * @brief JavaScript: C-like comments, backtick template literals may span lines.
+ */
+struct JavaScriptLanguage {
+    static constexpr const char* brackets = "()[]{}";
+    static constexpr const char* lineComment = "//";
+    static constexpr const char* blockCommentOpen = "/*";
+    static constexpr const char* blockCommentClose = "*/";
+    static constexpr const char* multiLineQuotes = "`";
+    static constexpr bool tripleQuotes = false;
+    static constexpr bool commentsInsideStrings = false;
+
+    static constexpr char quote_delimiter(char ch) {
+        return (ch == '"' || ch == '\'' || ch == '`') ? ch : '\0';
+    }
+};
+
+/**
+ * @struct PythonLanguage
+ * @brief Python: '#' comments, triple-quoted strings may span lines.
+ */
+struct PythonLanguage {
+    static constexpr const char* brackets = "()[]{}";
+    static constexpr const char* lineComment = "#";
+    static constexpr const char* blockCommentOpen = "";
+    static constexpr const char* blockCommentClose = "";
+    static constexpr const char* multiLineQuotes = "";
+    static constexpr bool tripleQuotes = true;
+    static constexpr bool commentsInsideStrings = false;
+
+    static constexpr char quote_delimiter(char ch) {
+        return (ch == '"' || ch == '\'') ? ch : '\0';
+    }
+};
+
+/**
+ * @struct XmlLanguage
+ * @brief XML-like configs: angle brackets and <!-- --> comments.
+ */
+struct XmlLanguage {
+    static constexpr const char* brackets = "<>";
+    static constexpr const char* lineComment = "";
+    static constexpr const char* blockCommentOpen = "<!--";
+    static constexpr const char* blockCommentClose = "-->";
+    static constexpr const char* multiLineQuotes = "";
+    static constexpr bool tripleQuotes = false;
+    static constexpr bool commentsInsideStrings = false;
+
+    static constexpr char quote_delimiter(char) {
+        return '\0';
+    }
+};
+
+
+/**
+ * @struct CharTable
+ * @brief Compile-time classification of all 256 byte values for one language.
+ */
+struct CharTable {
+    std::array<unsigned char, 256> classes{};   ///< CharClass bits per byte
+    std::array<char, 256> opener{};             ///< Matching opening bracket of a closing bracket
+    std::array<char, 256> delimiter{};          ///< Closing delimiter of a quote character
+};
+
+/**
+ * @brief Builds the classification table of a language policy.
+ * @tparam Language Language policy.
+ * @return The table, evaluated at compile time.
+ */
+template <class Language>
+constexpr CharTable make_char_table() {
+    CharTable table{};
+    for (const char* p = Language::brackets; p[0] != '\0' && p[1] != '\0'; p += 2) {
+        table.classes[static_cast<unsigned char>(p[0])] |= CHAR_OPEN;
+        table.classes[static_cast<unsigned char>(p[1])] |= CHAR_CLOSE;
+        table.opener[static_cast<unsigned char>(p[1])] = p[0];
+    }
+    if (Language::lineComment[0] != '\0') {
+        table.classes[static_cast<unsigned char>(Language::lineComment[0])] |= CHAR_LINE_COMMENT;
+    }
+    if (Language::blockCommentOpen[0] != '\0') {
+        table.classes[static_cast<unsigned char>(Language::blockCommentOpen[0])] |= CHAR_BLOCK_OPEN;
+        table.classes[static_cast<unsigned char>(Language::blockCommentClose[0])] |= CHAR_BLOCK_CLOSE;
+    }
+    for (int c = 0; c < 256; c++) {
+        char delimiter = Language::quote_delimiter(static_cast<char>(c));
+        if (delimiter != '\0') {
+            table.classes[c] |= CHAR_QUOTE;
+            table.delimiter[c] = delimiter;
+        }
+    }
+    return table;
+}
+
+/**
+ * @brief Returns true if the non-empty @p marker starts at position @p i of @p line.
+ */
+constexpr bool marker_at(std::string_view line, size_t i, std::string_view marker) {
+    return !marker.empty() && line.substr(i, marker.size()) == marker;
+}
+
+/**
+ * @brief Returns true if @p ch is a multi-line quote of the language.
+ */
+template <class Language>
+constexpr bool is_multi_line_quote(char ch) {
+    for (const char* p = Language::multiLineQuotes; *p != '\0'; p++) {
+        if (*p == ch) return true;
+    }
+    return false;
+}
+
+
+/**
+ * @brief Returns the index of the lowest set bit of a non-zero mask.
+ */
+inline unsigned lowest_bit_index(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+
+/**
+ * @brief Scans source lines and reports bracket events to a sink.
+ *
+ * Each line is classified in 64-byte blocks: a branch-free pass turns a block
+ * into a bitmask of the bytes that have a character class, and only those
+ * bytes are visited by the state machine. Blocks of ordinary text cost one
+ * table lookup per byte and no branches.
+ *
+ * The sink provides:
+ * - `void open(char bracket, int line, int column)`
+ * - `bool close(char bracket, char opener, int line, int column)`,
+ *   returning false to stop the scan.
+ * - `void budget_exceeded(int line, int column)`, called before the scan
+ *   stops because the budget ran out.
+ * - `size_t depth() const`, the number of open brackets.
+ *
+ * The budget is tested once per BUDGET_CHECK_INTERVAL bytes and its depth
+ * limit after every opening bracket; without a budget the only cost is a
+ * byte counter per block.
+ *
+ * The scan is linear in the input, whatever its shape. The only backward
+ * look is the backslash count before a closing quote candidate, and a run
+ * of backslashes ends at the character after it, so every byte is counted
+ * by at most one quote: O(1) amortised per byte, even for backslash storms.
+ *
+ * @tparam Language Language policy.
+ * @tparam Lines Random-access container of lines convertible to std::string_view.
+ * @tparam Sink Receiver of bracket events.
+ * @param lines [in] Source code lines.
+ * @param sink [in,out] Receiver of bracket events.
+ * @param budget [in,out] Optional time and byte budget.
+ * @return False if the sink stopped the scan or the budget ran out.
+ */
+template <class Language, class Lines, class Sink>
+bool scan_brackets(const Lines& lines, Sink& sink, CheckBudget* budget = nullptr) {
+    static constexpr CharTable table = make_char_table<Language>();
+    constexpr size_t blockOpenLength = std::char_traits<char>::length(Language::blockCommentOpen);
+    constexpr size_t blockCloseLength = std::char_traits<char>::length(Language::blockCommentClose);
+
+    bool inBlockComment = false;
+    bool inString = false;
+    bool multiLineString = false; // Current string may continue on the next line
+    bool tripleString = false;
+    char stringDelimiter = '\0';
+    size_t scanned = 0; // Bytes scanned so far, line ends included
+    size_t nextBudgetCheck = BUDGET_CHECK_INTERVAL;
+
+    for (size_t lineNum = 0; lineNum < lines.size(); lineNum++) {
+        std::string_view line = lines[lineNum];
+        if (budget && ++scanned >= nextBudgetCheck) {
+            nextBudgetCheck = scanned + BUDGET_CHECK_INTERVAL;
+            if (budget->spent(scanned)) {
+                sink.budget_exceeded(static_cast<int>(lineNum + 1), 1);
+                return false;
+            }
+        }
+        if (!multiLineString) {
+            inString = false;
+        }
+
+        size_t next = 0; // Characters before this index were consumed by a marker
+        bool lineDone = false;
+        for (size_t block = 0; block < line.size() && !lineDone; block += 64) {
+            size_t length = line.size() - block < 64 ? line.size() - block : 64;
+            uint64_t mask = 0;
+            for (size_t k = 0; k < length; k++) {
+                mask |= static_cast<uint64_t>(table.classes[static_cast<unsigned char>(line[block + k])] != 0) << k;
+            }
+            scanned += length;
+            if (budget && scanned >= nextBudgetCheck) {
+                nextBudgetCheck = scanned + BUDGET_CHECK_INTERVAL;
+                if (budget->spent(scanned)) {
+                    sink.budget_exceeded(static_cast<int>(lineNum + 1), static_cast<int>(block + 1));
+                    return false;
+                }
+            }
+
+            for (; mask != 0; mask &= mask - 1) {
+                size_t i = block + lowest_bit_index(mask);
+                if (i < next) continue;
+                next = i + 1;
+                char ch = line[i];
+                unsigned char cls = table.classes[static_cast<unsigned char>(ch)];
+
+                // Handle comments
+                if (inBlockComment) {
+                    if ((cls & CHAR_BLOCK_CLOSE) && marker_at(line, i, Language::blockCommentClose)) {
+                        inBlockComment = false; // End of block comment
+                        next = i + blockCloseLength;
+                    }
+                    continue;
+                }
+                if (Language::commentsInsideStrings || !inString) {
+                    if ((cls & CHAR_LINE_COMMENT) && marker_at(line, i, Language::lineComment)) {
+                        lineDone = true; // Rest of the line is a comment
+                        break;
+                    }
+                    if ((cls & CHAR_BLOCK_OPEN) && marker_at(line, i, Language::blockCommentOpen)) {
+                        inBlockComment = true; // Start of block comment
+                        next = i + blockOpenLength;
+                        continue;
+                    }
+                }
+
+                // Handle strings
+                if (!inString && (cls & CHAR_QUOTE)) {
+                    inString = true;
+                    stringDelimiter = table.delimiter[static_cast<unsigned char>(ch)];
+                    tripleString = Language::tripleQuotes && i + 2 < line.size() &&
+                        line[i + 1] == ch && line[i + 2] == ch;
+                    multiLineString = tripleString || is_multi_line_quote<Language>(ch);
+                    if (tripleString) next = i + 3;
+                    continue;
+                }
+                else if (inString) {
+                    if (ch == stringDelimiter &&
+                        (!tripleString || (i + 2 < line.size() && line[i + 1] == ch && line[i + 2] == ch))) {
+                        // Escaped if an odd run of backslashes precedes it; see the complexity note above
+                        int backslashes = 0;
+                        size_t j = i;
+                        while (j > 0 && line[--j] == '\\') {
+                            backslashes++;
+                        }
+                        if (backslashes % 2 == 0) {
+                            inString = false;
+                            multiLineString = false;
+                            if (tripleString) next = i + 3;
+                        }
+                    }
+                    continue;
+                }
+
+                // Handle brackets
+                if (cls & CHAR_OPEN) {
+                    sink.open(ch, static_cast<int>(lineNum + 1), static_cast<int>(i + 1));
+                    if (budget && budget->maxDepth != 0 && sink.depth() > budget->maxDepth) {
+                        budget->exceeded = true;
+                        sink.budget_exceeded(static_cast<int>(lineNum + 1), static_cast<int>(i + 1));
+                        return false;
+                    }
+                }
+                else if (cls & CHAR_CLOSE) {
+                    if (!sink.close(ch, table.opener[static_cast<unsigned char>(ch)],
+                        static_cast<int>(lineNum + 1), static_cast<int>(i + 1))) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @struct ErrorSink
+ * @brief Scan sink that records every wrong and unmatched bracket.
+ *
+ * When @c structure is set, matched pairs are recorded too.
+ * @tparam Allocator Allocator of the error set; the bracket stack uses its rebound form.
+ */
+template <class Allocator = std::allocator<BracketError>>
+struct ErrorSink {
+    using Entry = pair<char, pair<int, int>>;
+    using EntryAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Entry>;
+
+    stack<Entry, vector<Entry, EntryAllocator>> bracketStack; ///< Stack stores (bracket, (line, column))
+    set<BracketError, less<BracketError>, Allocator> errorPositions;
+    BracketStructure* structure = nullptr;
+    size_t maxDepth = 0;  ///< Deepest nesting reached so far
+
+    explicit ErrorSink(const Allocator& alloc = Allocator())
+        : bracketStack(EntryAllocator(alloc)), errorPositions(alloc) {
+    }
+
+    void open(char ch, int line, int column) {
+        bracketStack.push({ ch, { line, column } });
+        maxDepth = max(maxDepth, bracketStack.size());
+    }
+
+    bool close(char ch, char opener, int line, int column) {
+        if (!bracketStack.empty() && bracketStack.top().first == opener) {
+            if (structure) {
+                structure->openLine.push_back(bracketStack.top().second.first);
+                structure->openColumn.push_back(bracketStack.top().second.second);
+                structure->closeLine.push_back(line);
+                structure->closeColumn.push_back(column);
+                structure->depth.push_back(static_cast<int>(bracketStack.size()));
+            }
+            bracketStack.pop();
+        }
+        else {  // Wrong closing bracket
+            errorPositions.insert({ ch, line, column, WRONG_BRACKET });
+        }
+        return true;
+    }
+
+    void budget_exceeded(int line, int column) {
+        errorPositions.clear();
+        errorPositions.insert({ '\0', line, column, BUDGET_EXCEEDED });
+    }
+
+    size_t depth() const {
+        return bracketStack.size();
+    }
+};
+
+/**
+ * @brief Derives folding ranges from the matched pairs of a structure.
+ *
+ * Keeps the widest multi-line pair starting on each line.
+ * @param structure [in,out] Structure whose foldingRanges are rebuilt.
+ */
+inline void derive_folding_ranges(BracketStructure& structure) {
+    structure.foldingRanges.clear();
+    for (size_t k = 0; k < structure.openLine.size(); k++) {
+        if (structure.closeLine[k] > structure.openLine[k]) {
+            structure.foldingRanges.push_back({ structure.openLine[k], structure.closeLine[k] });
+        }
+    }
+    sort(structure.foldingRanges.begin(), structure.foldingRanges.end(),
+        [](const FoldingRange& a, const FoldingRange& b) {
+            return a.startLine != b.startLine ? a.startLine < b.startLine : a.endLine > b.endLine;
+        });
+    structure.foldingRanges.erase(unique(structure.foldingRanges.begin(), structure.foldingRanges.end(),
+        [](const FoldingRange& a, const FoldingRange& b) { return a.startLine == b.startLine; }),
+        structure.foldingRanges.end());
+}
+
+/**
+ * @struct VerdictSink
+ * @brief Scan sink that only decides whether the brackets are balanced.
+ *
+ * Keeps just the bracket characters on its stack and stops at the first
+ * wrong closing bracket. The deepest nesting is kept as well, so a caller
+ * learns it without running the full parser.
+ * @tparam Allocator Character allocator of the bracket stack.
+ */
+template <class Allocator = std::allocator<char>>
+struct VerdictSink {
+    std::basic_string<char, std::char_traits<char>, Allocator> bracketStack;
+    size_t maxDepth = 0;  ///< Deepest nesting reached so far
+
+    explicit VerdictSink(const Allocator& alloc = Allocator()) : bracketStack(alloc) {
+    }
+
+    void open(char ch, int, int) {
+        bracketStack.push_back(ch);
+        maxDepth = max(maxDepth, bracketStack.size());
+    }
+
+    bool close(char, char opener, int, int) {
+        if (bracketStack.empty() || bracketStack.back() != opener) {
+            return false;
+        }
+        bracketStack.pop_back();
+        return true;
+    }
+
+    void budget_exceeded(int, int) {
+    }
+
+    size_t depth() const {
+        return bracketStack.size();
+    }
+};
+
+
+/**
+ * @brief Parses brackets in the source code using a language policy.
+ * @tparam Language Language policy (CppLanguage, JsonLanguage, ...).
+ * @tparam Lines Random-access container of lines convertible to std::string_view.
+ * @tparam Allocator Allocator of the result set and the bracket stack.
+ * @param lines [in] Validated source code lines.
+ * @param structure [out] Optional; receives matched pairs, folding ranges and maximum depth.
+ * @param alloc [in] Allocator instance, e.g. a std::pmr::polymorphic_allocator.
+ * @param budget [in,out] Optional; when it runs out the result is a single BUDGET_EXCEEDED error.
+ * @param maxDepth [in,out] Optional; raised to the deepest nesting reached.
+ * @return Set of bracket errors (wrong or unmatched).
+ */
+template <class Language, class Lines, class Allocator = std::allocator<BracketError>>
+set<BracketError, less<BracketError>, Allocator> parse_brackets_as(const Lines& lines,
+    BracketStructure* structure = nullptr, const Allocator& alloc = Allocator(), CheckBudget* budget = nullptr,
+    int* maxDepth = nullptr) {
+    ErrorSink<Allocator> sink(alloc);
+    sink.structure = structure;
+    if (structure) {
+        structure->clear();
+    }
+    bool completed = scan_brackets<Language>(lines, sink, budget);
+    if (maxDepth) {
+        *maxDepth = max(*maxDepth, static_cast<int>(sink.maxDepth));
+    }
+    if (!completed) {
+        if (structure) {
+            structure->clear();
+        }
+        return sink.errorPositions;
+    }
+    if (structure) {
+        structure->maxDepth = static_cast<int>(sink.maxDepth);
+        derive_folding_ranges(*structure);
+    }
+
+    // Add remaining unmatched opening brackets
+    while (!sink.bracketStack.empty()) {
+        auto top = sink.bracketStack.top();
+        sink.errorPositions.insert({ top.first, top.second.first, top.second.second, UNMATCHED_BRACKET });
+        sink.bracketStack.pop();
+    }
+
+    return sink.errorPositions;
+}
+
+
+/**
+ * @brief Decides whether all brackets are balanced using a language policy.
+ *
+ * Much cheaper than parse_brackets_as() because no positions or errors are
+ * recorded; run parse_brackets_as() only when this returns false.
+ * @tparam Language Language policy.
+ * @tparam Lines Random-access container of lines convertible to std::string_view.
+ * @tparam Allocator Character allocator of the bracket stack.
+ * @param lines [in] Validated source code lines.
+ * @param alloc [in] Allocator instance.
+ * @param budget [in,out] Optional; false is returned when it runs out.
+ * @param maxDepth [in,out] Optional; raised to the deepest nesting reached before the scan ended.
+ * @return True if parse_brackets_as() would report no errors.
+ */
+template <class Language, class Lines, class Allocator = std::allocator<char>>
+bool brackets_balanced_as(const Lines& lines, const Allocator& alloc = Allocator(), CheckBudget* budget = nullptr,
+    int* maxDepth = nullptr) {
+    VerdictSink<Allocator> sink(alloc);
+    bool balanced = scan_brackets<Language>(lines, sink, budget) && sink.bracketStack.empty();
+    if (maxDepth) {
+        *maxDepth = max(*maxDepth, static_cast<int>(sink.maxDepth));
+    }
+    return balanced;
+}
+
+
+#endif // BRACKETLANGUAGES_H
@@ -0,0 +1,170 @@
+/**
+ * @file CheckStats.cpp
+ * @brief Implementation of the check statistics.
+ */
+#include "CheckStats.h"
+
+#include <iomanip>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+
+static const char* const phaseNames[PHASE_COUNT] = { "read", "validate", "parse", "print" };
+
+static const char* const errorTypeNames[ERROR_TYPE_COUNT] = {
+    "WRONG_BRACKET", "UNMATCHED_BRACKET", "TOO_LONG_PROGRAM", "TOO_LONG_LINE", "MACRO_USAGE", "BUDGET_EXCEEDED"
+};
+
+
+const char* phase_name(CheckPhase phase) {
+    return phase < PHASE_COUNT ? phaseNames[phase] : "unknown";
+}
+
+
+void CheckStats::count_input(const vector<string>& input) {
+    files++;
+    lines += input.size();
+    for (const string& line : input) {
+        bytes += line.size() + 1;
+    }
+}
+
+void CheckStats::count_errors(const set<BracketError>& errors) {
+    for (const BracketError& error : errors) {
+        errorCounts[error.type]++;
+    }
+}
+
+void CheckStats::merge(const CheckStats& other) {
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        phases[i].wallSeconds += other.phases[i].wallSeconds;
+        phases[i].cpuSeconds += other.phases[i].cpuSeconds;
+    }
+    files += other.files;
+    bytes += other.bytes;
+    lines += other.lines;
+    maxDepth = max(maxDepth, other.maxDepth);
+    for (size_t i = 0; i < ERROR_TYPE_COUNT; i++) {
+        errorCounts[i] += other.errorCounts[i];
+    }
+    peakRssBytes = max(peakRssBytes, other.peakRssBytes);
+}
+
+
+PhaseTimer::PhaseTimer(PhaseStats& phase)
+    : phase(phase), wallStart(chrono::steady_clock::now()), cpuStart(thread_cpu_seconds()) {
+}
+
+PhaseTimer::~PhaseTimer() {
+    phase.wallSeconds += chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+    phase.cpuSeconds += thread_cpu_seconds() - cpuStart;
+}
+
+
+double thread_cpu_seconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    ULARGE_INTEGER kernelTime = { { kernel.dwLowDateTime, kernel.dwHighDateTime } };
+    ULARGE_INTEGER userTime = { { user.dwLowDateTime, user.dwHighDateTime } };
+    return static_cast<double>(kernelTime.QuadPart + userTime.QuadPart) * 1e-7; // 100 ns units
+#else
+    timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) {
+        return 0;
+    }
+    return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) * 1e-9;
+#endif
+}
+
+size_t peak_rss_bytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);        // bytes
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#endif
+}
+
+
+// Input megabytes per second of wall time, 0 for phases too short to measure
+static double megabytes_per_second(uint64_t bytes, double seconds) {
+    return seconds > 0 ? static_cast<double>(bytes) / 1e6 / seconds : 0;
+}
+
+void print_stats(ostream& out, const CheckStats& stats, bool json) {
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+    out << fixed << setprecision(3);
+
+    if (json) {
+        out << "{\"files\": " << stats.files << ", \"bytes\": " << stats.bytes << ", \"lines\": " << stats.lines
+            << ", \"maxDepth\": " << stats.maxDepth << ", \"peakRssBytes\": " << stats.peakRssBytes
+            << ", \"workers\": " << stats.workers << ", \"runWallMs\": " << stats.runWallSeconds * 1e3
+            << ", \"mbPerSec\": " << megabytes_per_second(stats.bytes, stats.runWallSeconds) << ", \"phases\": {";
+        for (size_t i = 0; i < PHASE_COUNT; i++) {
+            const PhaseStats& phase = stats.phases[i];
+            out << (i ? ", " : "") << "\"" << phase_name(static_cast<CheckPhase>(i)) << "\": {\"wallMs\": " << phase.wallSeconds * 1e3
+                << ", \"cpuMs\": " << phase.cpuSeconds * 1e3
+                << ", \"mbPerSec\": " << megabytes_per_second(stats.bytes, phase.wallSeconds) << "}";
+        }
+        out << "}, \"errors\": {";
+        for (size_t i = 0; i < ERROR_TYPE_COUNT; i++) {
+            out << (i ? ", " : "") << "\"" << errorTypeNames[i] << "\": " << stats.errorCounts[i];
+        }
+        out << "}}" << endl;
+    }
+    else {
+        out << "Files: " << stats.files << ", lines: " << stats.lines << ", bytes: " << stats.bytes
+            << ", max bracket depth: " << stats.maxDepth
+            << ", peak RSS: " << static_cast<double>(stats.peakRssBytes) / (1024 * 1024) << " MB" << endl;
+        // Phase times of several workers are summed, so their rates are per worker
+        bool summed = stats.workers > 1;
+        if (stats.runWallSeconds > 0) {
+            out << "Run: " << stats.runWallSeconds * 1e3 << " ms wall";
+            if (summed) {
+                out << " on " << stats.workers << " threads";
+            }
+            out << ", " << megabytes_per_second(stats.bytes, stats.runWallSeconds) << " MB/s" << endl;
+        }
+        out << left << setw(10) << "Phase" << right << setw(12) << (summed ? "Worker ms" : "Wall ms") << setw(12) << "CPU ms"
+            << setw(12) << (summed ? "MB/s/worker" : "MB/s") << endl;
+        for (size_t i = 0; i < PHASE_COUNT; i++) {
+            const PhaseStats& phase = stats.phases[i];
+            out << left << setw(10) << phase_name(static_cast<CheckPhase>(i)) << right << setw(12) << phase.wallSeconds * 1e3
+                << setw(12) << phase.cpuSeconds * 1e3
+                << setw(12) << megabytes_per_second(stats.bytes, phase.wallSeconds) << endl;
+        }
+        out << "Errors:";
+        for (size_t i = 0; i < ERROR_TYPE_COUNT; i++) {
+            out << " " << errorTypeNames[i] << "=" << stats.errorCounts[i];
+        }
+        out << endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
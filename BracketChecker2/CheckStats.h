@@ -0,0 +1,149 @@
+/**
+ * @file CheckStats.h
+ * @brief Per-phase timing and memory statistics of bracket checks.
+ *
+ * A check runs four phases: reading the input, code_validation(),
+ * parse_brackets() and print_result(). PhaseTimer records the wall and CPU
+ * time of one phase; CheckStats collects the phases together with the input
+ * size, the deepest bracket nesting and the errors found. Statistics of
+ * several files are combined with CheckStats::merge(). When they come from
+ * several worker threads, the phase times are summed over the workers and
+ * can exceed the wall time of the run, which is recorded separately.
+ */
+
+#pragma once
+#ifndef CHECKSTATS_H
+#define CHECKSTATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include "BracketChecker2.h"
+
+
+/**
+ * @enum CheckPhase
+ * @brief Phases of checking one file.
+ */
+enum CheckPhase {
+    PHASE_READ,      ///< read_input_file()
+    PHASE_VALIDATE,  ///< code_validation()
+    PHASE_PARSE,     ///< brackets_balanced() and parse_brackets()
+    PHASE_PRINT,     ///< print_result()
+    PHASE_COUNT
+};
+
+/// Number of BracketErrorType values.
+const size_t ERROR_TYPE_COUNT = BUDGET_EXCEEDED + 1;
+
+
+/**
+ * @struct PhaseStats
+ * @brief Time spent in one phase, summed over all files.
+ */
+struct PhaseStats {
+    double wallSeconds = 0;
+    double cpuSeconds = 0;
+};
+
+
+/**
+ * @struct CheckStats
+ * @brief Statistics of one or more checked files.
+ */
+struct CheckStats {
+    PhaseStats phases[PHASE_COUNT];
+    uint64_t files = 0;
+    uint64_t bytes = 0;        ///< Text bytes, line ends included
+    uint64_t lines = 0;
+    int maxDepth = 0;          ///< Deepest bracket nesting of any file
+    uint64_t errorCounts[ERROR_TYPE_COUNT] = {};
+    size_t peakRssBytes = 0;   ///< Peak resident set size of the process
+    double runWallSeconds = 0; ///< Wall time of the whole run; 0 if not measured
+    unsigned workers = 1;      ///< Threads whose phase times are summed
+
+    /**
+     * @brief Counts one input file.
+     * @param input [in] Lines as returned by read_input_file().
+     */
+    void count_input(const vector<string>& input);
+
+    /**
+     * @brief Counts one input file held in another container, e.g. the lines of the pmr read_input_file().
+     * @tparam Lines Container of strings.
+     */
+    template <class Lines>
+    void count_input(const Lines& input) {
+        files++;
+        lines += input.size();
+        for (const auto& line : input) {
+            bytes += line.size() + 1;
+        }
+    }
+
+    /**
+     * @brief Adds errors to the per-type counters.
+     * @param errors [in] Errors reported for a file.
+     */
+    void count_errors(const set<BracketError>& errors);
+
+    /**
+     * @brief Adds the statistics of other files, e.g. from another worker thread.
+     * @param other [in] Statistics to add.
+     */
+    void merge(const CheckStats& other);
+};
+
+
+/**
+ * @class PhaseTimer
+ * @brief Adds the wall and CPU time of its own lifetime to a phase.
+ *
+ * CPU time is the time of the calling thread, so timers of parallel
+ * workers do not include each other.
+ */
+class PhaseTimer {
+public:
+    explicit PhaseTimer(PhaseStats& phase);
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    PhaseStats& phase;
+    chrono::steady_clock::time_point wallStart;
+    double cpuStart;
+};
+
+
+/**
+ * @brief Short lowercase name of a phase, e.g. "parse".
+ */
+const char* phase_name(CheckPhase phase);
+
+
+/**
+ * @brief CPU time consumed by the calling thread.
+ * @return Seconds since the thread started.
+ */
+double thread_cpu_seconds();
+
+
+/**
+ * @brief Peak resident set size of the process.
+ * @return Bytes, or 0 if the platform does not report it.
+ */
+size_t peak_rss_bytes();
+
+
+/**
+ * @brief Writes statistics as a table or as a JSON object.
+ * @param out [in,out] Destination stream.
+ * @param stats [in] Statistics to write.
+ * @param json [in] True for JSON, false for human-readable text.
+ */
+void print_stats(ostream& out, const CheckStats& stats, bool json);
+
+
+#endif // CHECKSTATS_H
@@ -0,0 +1,260 @@
+/**
+ * @file CompileCommands.cpp
+ * @brief Streaming reader of compile_commands.json.
+ */
+#include "CompileCommands.h"
+
+#include <filesystem>
+#include <unordered_set>
+
+
+namespace {
+    /**
+     * @class JsonStream
+     * @brief Pull reader of JSON tokens over a stream, one buffer at a time.
+     */
+    class JsonStream {
+    public:
+        explicit JsonStream(istream& in) : in(in) {
+        }
+
+        /// Next character after whitespace, or EOF.
+        int peek() {
+            int ch = peek_raw();
+            while (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
+                pos++;
+                ch = peek_raw();
+            }
+            return ch;
+        }
+
+        /// Consumes the next non-blank character if it is the expected one.
+        bool consume(char expected) {
+            if (peek() != expected) {
+                return false;
+            }
+            pos++;
+            return true;
+        }
+
+        /// Reads a string token, decoding escapes to UTF-8.
+        bool read_string(string& value) {
+            value.clear();
+            if (!consume('"')) {
+                return false;
+            }
+            while (true) {
+                int ch = get();
+                if (ch == EOF || ch == '\n') {
+                    return false;
+                }
+                if (ch == '"') {
+                    return true;
+                }
+                if (ch != '\\') {
+                    value += static_cast<char>(ch);
+                    continue;
+                }
+                ch = get();
+                switch (ch) {
+                case '"': case '\\': case '/': value += static_cast<char>(ch); break;
+                case 'b': value += '\b'; break;
+                case 'f': value += '\f'; break;
+                case 'n': value += '\n'; break;
+                case 'r': value += '\r'; break;
+                case 't': value += '\t'; break;
+                case 'u': {
+                    uint32_t code = 0;
+                    if (!read_hex4(code)) {
+                        return false;
+                    }
+                    // A high surrogate is followed by the low one of the pair
+                    if (code >= 0xD800 && code < 0xDC00 && get() == '\\' && get() == 'u') {
+                        uint32_t low = 0;
+                        if (!read_hex4(low) || low < 0xDC00 || low >= 0xE000) {
+                            return false;
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(value, code);
+                    break;
+                }
+                default:
+                    return false;
+                }
+            }
+        }
+
+        /// Skips one value of any type without storing it.
+        bool skip_value() {
+            string ignored;
+            int depth = 0;
+            do {
+                int ch = peek();
+                if (ch == EOF) {
+                    return false;
+                }
+                if (ch == '"') {
+                    if (!read_string(ignored)) {
+                        return false;
+                    }
+                }
+                else if (ch == '{' || ch == '[') {
+                    pos++;
+                    depth++;
+                }
+                else if (ch == '}' || ch == ']' || ch == ',' || ch == ':') {
+                    if (depth == 0) {
+                        return false;
+                    }
+                    pos++;
+                    depth -= ch == '}' || ch == ']';
+                }
+                else {
+                    // Number, true, false or null
+                    while (ch != EOF && ch != ',' && ch != '}' && ch != ']' && ch != ':' &&
+                        ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r') {
+                        pos++;
+                        ch = peek_raw();
+                    }
+                }
+            } while (depth > 0);
+            return true;
+        }
+
+        /// Bytes consumed so far, for error messages.
+        size_t offset() const {
+            return consumed + pos;
+        }
+
+    private:
+        int peek_raw() {
+            if (pos == end && !fill()) {
+                return EOF;
+            }
+            return static_cast<unsigned char>(buffer[pos]);
+        }
+
+        int get() {
+            int ch = peek_raw();
+            if (ch != EOF) {
+                pos++;
+            }
+            return ch;
+        }
+
+        bool fill() {
+            consumed += end;
+            pos = end = 0;
+            in.read(buffer, sizeof(buffer));
+            end = static_cast<size_t>(in.gcount());
+            return end != 0;
+        }
+
+        bool read_hex4(uint32_t& code) {
+            for (int i = 0; i < 4; i++) {
+                int ch = get();
+                code <<= 4;
+                if (ch >= '0' && ch <= '9') code |= ch - '0';
+                else if (ch >= 'a' && ch <= 'f') code |= ch - 'a' + 10;
+                else if (ch >= 'A' && ch <= 'F') code |= ch - 'A' + 10;
+                else return false;
+            }
+            return true;
+        }
+
+        static void append_utf8(string& out, uint32_t code) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            }
+            else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        istream& in;
+        char buffer[BUDGET_CHECK_INTERVAL];
+        size_t pos = 0;
+        size_t end = 0;
+        size_t consumed = 0;  ///< Bytes of the buffers before the current one
+    };
+}
+
+
+bool read_compile_commands(const string& databaseFile, vector<string>& files, string& error) {
+    namespace fs = std::filesystem;
+    files.clear();
+    ifstream in(databaseFile, ios::binary);
+    if (!in.is_open()) {
+        error = "Cannot open " + databaseFile;
+        return false;
+    }
+    auto stream = make_unique<JsonStream>(in);
+    JsonStream& json = *stream;
+    auto fail = [&](const char* what) {
+        error = string(what) + " at byte " + to_string(json.offset()) + " of " + databaseFile;
+        return false;
+    };
+
+    fs::path databaseDirectory = fs::absolute(fs::path(databaseFile)).parent_path();
+    unordered_set<string> seen;
+    if (!json.consume('[')) {
+        return fail("Expected '['");
+    }
+    if (json.consume(']')) {
+        return true;
+    }
+    do {
+        if (!json.consume('{')) {
+            return fail("Expected an object");
+        }
+        string directory;
+        string file;
+        string key;
+        if (!json.consume('}')) {
+            do {
+                if (!json.read_string(key) || !json.consume(':')) {
+                    return fail("Expected a member name");
+                }
+                bool valid = key == "directory" ? json.read_string(directory)
+                    : key == "file" ? json.read_string(file)
+                    : json.skip_value();
+                if (!valid) {
+                    return fail("Invalid value");
+                }
+            } while (json.consume(','));
+            if (!json.consume('}')) {
+                return fail("Expected '}'");
+            }
+        }
+        if (file.empty()) {
+            continue;
+        }
+
+        fs::path path(file);
+        if (path.is_relative()) {
+            fs::path base(directory);
+            path = (base.is_relative() ? databaseDirectory / base : base) / path;
+        }
+        string normal = path.lexically_normal().string();
+        if (seen.insert(normal).second) {
+            files.push_back(move(normal));
+        }
+    } while (json.consume(','));
+    if (!json.consume(']')) {
+        return fail("Expected ']'");
+    }
+    return true;
+}
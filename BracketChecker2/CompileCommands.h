@@ -0,0 +1,34 @@
+/**
+ * @file CompileCommands.h
+ * @brief Source file list of a compilation database (compile_commands.json).
+ *
+ * The database is read with a streaming JSON reader: only the "directory"
+ * and "file" members of each entry are kept, and everything else, such as
+ * long "command" strings or "arguments" arrays, is skipped without being
+ * stored. Memory use therefore does not grow with the size of the database,
+ * only with the number of distinct files.
+ */
+
+#pragma once
+#ifndef COMPILECOMMANDS_H
+#define COMPILECOMMANDS_H
+
+#include "BracketChecker2.h"
+
+
+/**
+ * @brief Reads the source files of a compilation database.
+ *
+ * Relative "file" members are resolved against the entry's "directory", and
+ * a relative "directory" against the directory of the database. Paths are
+ * normalised, so a file compiled in several configurations is listed once.
+ *
+ * @param databaseFile [in] Path of compile_commands.json.
+ * @param files [out] Each source file once, in order of first appearance.
+ * @param error [out] Why the database could not be read, with the byte offset.
+ * @return False if the file cannot be opened or is not a valid database.
+ */
+bool read_compile_commands(const string& databaseFile, vector<string>& files, string& error);
+
+
+#endif // COMPILECOMMANDS_H
@@ -0,0 +1,249 @@
+/**
+ * @file CorpusGenerator.cpp
+ * @brief Implementation of the source generator and its ground truth.
+ */
+#include "CorpusGenerator.h"
+
+
+namespace {
+    const char* const identifiers[] = { "value", "count", "items", "result", "index", "total", "node", "buffer" };
+
+    // No '/' or '*' in comment words, so a block comment only ends at its closer
+    const char* const commentWords[] = { "note", "call", "f(x)", "when", "{ready}", "[i]", "(", "]", "\"quoted\"",
+        "it's", "a\\b", "TODO", "->", "<tag>", "'{'", "}" };
+    const char* const lineCommentWords[] = { "/*", "*/", "// twice", "\"unterminated" };
+    const char* const nonAsciiWords[] = { "größe", "naïve", "café", "日本語", "Привет", "“curly”", "‘single’", "—", "✓", "€" };
+
+    // Complete escapes only, so a string never ends in a lone backslash; no '/' either,
+    // because the checker sees comment markers inside strings
+    const char* const stringPieces[] = { "text", " ", "(", "[", "{", "}", ")", "]", "<", "'", "\\\"", "\\\\",
+        "\\\\\\\"", "\\n", "\\t", "\\\\\\\\" };
+    const char* const charLiterals[] = { "'{'", "'}'", "'('", "']'", "'\\''", "'\\\\'", "'\"'", "'a'", "'\\n'" };
+
+    char closer_of(char opener) {
+        return opener == '(' ? ')' : opener == '[' ? ']' : '}';
+    }
+
+
+    /// Writes the source and simulates the checker's bracket stack on the way.
+    class SourceWriter {
+    public:
+        explicit SourceWriter(const CorpusOptions& options) : options(options), random(options.seed) {
+            result.text.reserve(options.bytes + 256);
+            if (options.bom) {
+                result.text = "\xEF\xBB\xBF";
+            }
+        }
+
+        bool full() const {
+            return result.text.size() + line.size() >= options.bytes;
+        }
+
+        void statement() {
+            double roll = random.uniform();
+            if (roll < options.commentDensity) {
+                indent(stack.size());
+                if (random.chance(options.blockCommentShare)) {
+                    block_comment();
+                    end_line();
+                }
+                else {
+                    line_comment();
+                }
+                return;
+            }
+            bool literals = roll < options.commentDensity + options.stringDensity;
+
+            double openBias = static_cast<int>(stack.size()) * 2 < options.maxDepth ? 0.6 : 0.3;
+            if (can_open() && random.chance(openBias)) {
+                indent(stack.size());
+                line += "if ";
+                open('(');
+                expression(2, literals);
+                close();
+                line += ' ';
+                open('{');
+            }
+            else if (!stack.empty() && random.chance(0.4)) {
+                indent(stack.size() - 1);
+                close();
+            }
+            else {
+                indent(stack.size());
+                line += pick(identifiers);
+                line += " = ";
+                expression(3, literals);
+                line += ';';
+                if (random.chance(0.1)) {
+                    line += ' ';
+                    line_comment();
+                    return;
+                }
+            }
+            end_line();
+        }
+
+        GeneratedSource finish() {
+            while (!stack.empty() && !random.chance(options.errorDensity)) {
+                indent(stack.size() - 1);
+                close();
+                end_line();
+            }
+            if (!line.empty()) {
+                end_line();
+            }
+            for (const auto& entry : stack) {
+                result.expected.insert({ entry.first, entry.second.first, entry.second.second, UNMATCHED_BRACKET });
+            }
+            result.lineCount = static_cast<size_t>(lineNumber - 1);
+            return move(result);
+        }
+
+    private:
+        template <size_t N>
+        const char* pick(const char* const (&words)[N]) {
+            return words[random.below(N)];
+        }
+
+        int column() const {
+            return static_cast<int>(line.size() + 1);
+        }
+
+        bool can_open() const {
+            return static_cast<int>(stack.size()) < options.maxDepth;
+        }
+
+        void open(char bracket) {
+            stack.push_back({ bracket, { lineNumber, column() } });
+            result.maxDepth = max(result.maxDepth, static_cast<int>(stack.size()));
+            line += bracket;
+        }
+
+        // Closes the innermost bracket, or writes a wrong closer that leaves it open
+        void close() {
+            if (stack.empty()) {
+                return;
+            }
+            char closer = closer_of(stack.back().first);
+            if (random.chance(options.errorDensity)) {
+                const char closers[] = ")]}";
+                size_t right = closer == ')' ? 0 : closer == ']' ? 1 : 2;
+                char wrong = closers[(right + 1 + random.below(2)) % 3];
+                result.expected.insert({ wrong, lineNumber, column(), WRONG_BRACKET });
+                line += wrong;
+                return;
+            }
+            line += closer;
+            stack.pop_back();
+        }
+
+        void end_line() {
+            result.text += line;
+            result.text += options.crlf ? "\r\n" : "\n";
+            line.clear();
+            lineNumber++;
+        }
+
+        void indent(size_t depth) {
+            line.append(4 * min<size_t>(depth, 10), ' ');
+        }
+
+        void comment_word() {
+            line += random.chance(options.nonAsciiDensity) ? pick(nonAsciiWords) : pick(commentWords);
+        }
+
+        void line_comment() {
+            line += "//";
+            for (size_t words = 1 + random.below(8); words > 0; words--) {
+                line += ' ';
+                if (random.chance(0.15)) {
+                    line += pick(lineCommentWords);
+                }
+                else {
+                    comment_word();
+                }
+            }
+            end_line();
+        }
+
+        void block_comment() {
+            line += "/*";
+            for (size_t words = 1 + random.below(12); words > 0; words--) {
+                if (random.chance(0.2)) {
+                    end_line();
+                }
+                line += ' ';
+                comment_word();
+            }
+            line += " */";
+        }
+
+        void string_literal() {
+            line += '"';
+            for (size_t pieces = random.below(8); pieces > 0; pieces--) {
+                line += pick(stringPieces);
+            }
+            line += '"';
+        }
+
+        void expression(int depth, bool literals) {
+            size_t kind = random.below(literals ? 7 : 5);
+            if ((depth <= 0 || !can_open()) && kind >= 2 && kind <= 4) {
+                kind = kind % 2;  // No more nesting: a name or a number
+            }
+            switch (kind) {
+            case 0:
+                line += pick(identifiers);
+                break;
+            case 1:
+                line += to_string(random.below(1000));
+                break;
+            case 2: {
+                line += pick(identifiers);
+                open('(');
+                for (size_t args = random.below(4), i = 0; i < args; i++) {
+                    if (i > 0) line += ", ";
+                    expression(depth - 1, literals);
+                }
+                close();
+                break;
+            }
+            case 3:
+                line += pick(identifiers);
+                open('[');
+                expression(depth - 1, literals);
+                close();
+                break;
+            case 4:
+                open('{');
+                expression(depth - 1, literals);
+                line += ", ";
+                expression(depth - 1, literals);
+                close();
+                break;
+            case 5:
+                string_literal();
+                break;
+            default:
+                line += pick(charLiterals);
+                break;
+            }
+        }
+
+        const CorpusOptions& options;
+        SplitMix64 random;
+        GeneratedSource result;
+        string line;
+        int lineNumber = 1;
+        vector<pair<char, pair<int, int>>> stack;   ///< Open brackets as the checker sees them: (bracket, (line, column))
+    };
+}
+
+
+GeneratedSource generate_source(const CorpusOptions& options) {
+    SourceWriter writer(options);
+    while (!writer.full()) {
+        writer.statement();
+    }
+    return writer.finish();
+}
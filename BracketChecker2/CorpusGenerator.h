@@ -0,0 +1,101 @@
+/**
+ * @file CorpusGenerator.h
+ * @brief Deterministic generator of C/C++-like sources with known bracket errors.
+ *
+ * generate_source() writes code token by token and simulates the checker's
+ * bracket stack while doing so, so the expected error set is known exactly
+ * without running the checker. Strings with escaped quotes and backslash
+ * runs, char literals, line and multi-line block comments with non-ASCII
+ * text, CRLF endings and a UTF-8 BOM are all produced. The same seed and
+ * options give the same bytes on every platform: the generator uses its own
+ * SplitMix64 instead of the library distributions, whose results differ
+ * between standard libraries.
+ */
+
+#pragma once
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <cstdint>
+#include "BracketChecker2.h"
+
+
+/**
+ * @class SplitMix64
+ * @brief Small, portable pseudo-random generator.
+ */
+class SplitMix64 {
+public:
+    explicit SplitMix64(uint64_t seed) : state(seed) {
+    }
+
+    /// Next 64 random bits.
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /// Uniform value in [0, 1).
+    double uniform() {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /// True with the given probability.
+    bool chance(double probability) {
+        return uniform() < probability;
+    }
+
+    /// Uniform value in [0, count); count must not be 0.
+    size_t below(size_t count) {
+        return static_cast<size_t>(next() % count);
+    }
+
+private:
+    uint64_t state;
+};
+
+
+/**
+ * @struct CorpusOptions
+ * @brief Shape of a generated source.
+ */
+struct CorpusOptions {
+    uint64_t seed = 1;
+    size_t bytes = 4096;             ///< Approximate size of the text
+    int maxDepth = 8;                ///< Maximum bracket nesting depth
+    double commentDensity = 0.15;    ///< Share of statements that are comments
+    double stringDensity = 0.15;     ///< Share of statements with string and char literals
+    double errorDensity = 0.0;       ///< Probability of a wrong closer per bracket, and of leaving the end unclosed
+    double nonAsciiDensity = 0.2;    ///< Share of non-ASCII words in comments
+    double blockCommentShare = 0.5;  ///< Share of comments that are block comments
+    bool crlf = false;               ///< CRLF line endings
+    bool bom = false;                ///< Start with a UTF-8 byte order mark
+};
+
+
+/**
+ * @struct GeneratedSource
+ * @brief Generated text and the errors parse_brackets() must report for it.
+ */
+struct GeneratedSource {
+    string text;
+    set<BracketError> expected;
+    size_t lineCount = 0;
+    int maxDepth = 0;                ///< Deepest nesting reached
+};
+
+
+/**
+ * @brief Generates a C/C++-like source.
+ *
+ * Lines stay below MAX_LINE_LENGTH and no macros are used, so only the
+ * size decides whether code_validation() accepts the result.
+ * @param options [in] Seed, size and densities.
+ * @return The text and its expected bracket errors for LANGUAGE_CPP.
+ */
+GeneratedSource generate_source(const CorpusOptions& options);
+
+
+#endif // CORPUSGENERATOR_H
@@ -0,0 +1,279 @@
+/**
+ * @file DirectoryWalker.cpp
+ * @brief Implementation of the parallel source tree walk.
+ */
+#include "DirectoryWalker.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+
+vector<string> default_source_extensions() {
+    return { ".cpp", ".cc", ".h", ".hpp", ".inl" };
+}
+
+vector<string> parse_extension_list(const string& list) {
+    vector<string> extensions;
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == string::npos) {
+            end = list.size();
+        }
+        string extension = list.substr(pos, end - pos);
+        if (!extension.empty()) {
+            extensions.push_back(extension[0] == '.' ? extension : "." + extension);
+        }
+        pos = end + 1;
+    }
+    return extensions;
+}
+
+bool has_source_extension(const string& path, const vector<string>& extensions) {
+    for (const string& extension : extensions) {
+        if (path.size() > extension.size() &&
+            path.compare(path.size() - extension.size(), extension.size(), extension) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned walk_thread_count(const WalkOptions& options) {
+    return options.threads != 0 ? options.threads : max(1u, thread::hardware_concurrency());
+}
+
+
+namespace {
+    namespace fs = std::filesystem;
+
+    // True if inner is outer or lies below it; both are canonical
+    bool contains(const fs::path& outer, const fs::path& inner) {
+        auto mismatchAt = mismatch(outer.begin(), outer.end(), inner.begin(), inner.end());
+        return mismatchAt.first == outer.end();
+    }
+
+    /**
+     * @class TreeWalk
+     * @brief Task queue and counters shared by the workers of one walk.
+     *
+     * A task lists a directory or visits a file. Files are queued in front
+     * of directories, so they are checked soon after they are found and the
+     * queue stays short; directories keep the other workers supplied.
+     */
+    class TreeWalk {
+    public:
+        TreeWalk(const WalkOptions& options, const function<void(const string&, unsigned)>& visit)
+            : options(options), visit(visit) {
+        }
+
+        WalkSummary run(const string& root) {
+            error_code error;
+            fs::path canonicalRoot = fs::canonical(root, error);
+            if (error || !fs::is_directory(canonicalRoot, error)) {
+                summary.unreadable++;
+                return summary;
+            }
+            tasks.push_back({ root, "", true, make_shared<PathFilter>(options.exclude), canonicalRoot, nullptr });
+            pending = 1;
+
+            vector<thread> workers;
+            unsigned count = walk_thread_count(options);
+            for (unsigned i = 0; i < count; i++) {
+                workers.emplace_back([this, i] { work(i); });
+            }
+            for (thread& worker : workers) {
+                worker.join();
+            }
+            return summary;
+        }
+
+    private:
+        /**
+         * @struct LinkHop
+         * @brief A followed directory link on the way from the root to a directory.
+         */
+        struct LinkHop {
+            fs::path from;                       ///< Canonical directory holding the link
+            shared_ptr<const LinkHop> previous;  ///< Hop before it, null for the first
+        };
+
+        struct Task {
+            string path;
+            string relative;                      ///< Path below the root, '/'-separated
+            bool directory;
+            shared_ptr<const PathFilter> filter;  ///< Rules in force inside a directory
+            fs::path canonical;                   ///< Canonical path of a directory
+            shared_ptr<const LinkHop> hops;       ///< Links followed to reach a directory, last first
+        };
+
+        void work(unsigned worker) {
+            while (true) {
+                Task task;
+                {
+                    unique_lock<mutex> guard(lock);
+                    ready.wait(guard, [this] { return !tasks.empty() || pending == 0; });
+                    if (tasks.empty()) {
+                        return;
+                    }
+                    task = move(tasks.front());
+                    tasks.pop_front();
+                }
+                if (task.directory) {
+                    list_directory(task);
+                }
+                else {
+                    visit(task.path, worker);
+                }
+                lock_guard<mutex> guard(lock);
+                if (--pending == 0) {
+                    ready.notify_all();
+                }
+            }
+        }
+
+        // Queues the subdirectories and matching files of one directory in a single batch
+        void list_directory(const Task& directory) {
+            const string& path = directory.path;
+            shared_ptr<const PathFilter> filter = directory.filter;
+            error_code error;
+            if (options.readIgnoreFiles && fs::is_regular_file(fs::path(path) / ".gitignore", error)) {
+                auto nested = make_shared<PathFilter>(filter);
+                nested->add_file((fs::path(path) / ".gitignore").string(), directory.relative);
+                filter = nested;
+            }
+
+            vector<Task> found;
+            uint64_t skipped = 0;
+            uint64_t ignored = 0;
+            bool readable = true;
+            error.clear();
+            fs::directory_iterator entries(path, fs::directory_options::skip_permission_denied, error);
+            if (error) {
+                readable = false;
+            }
+            for (; !error && entries != fs::directory_iterator(); entries.increment(error)) {
+                // The entry caches the type read with the name, so this does not stat each file
+                const fs::directory_entry& entry = *entries;
+                error_code typeError;
+                bool isDirectory = entry.is_directory(typeError);
+                if (!isDirectory && !entry.is_regular_file(typeError)) {
+                    continue;
+                }
+                // Git's object store holds no sources and can have thousands of directories
+                if (isDirectory && entry.path().filename() == ".git") {
+                    continue;
+                }
+                string file = entry.path().string();
+                if (!isDirectory && !has_source_extension(file, options.extensions)) {
+                    continue;
+                }
+                string relative = entry.path().filename().string();
+                if (!directory.relative.empty()) {
+                    relative = directory.relative + "/" + relative;
+                }
+                if (filter->ignored(relative, isDirectory)) {
+                    ignored++;
+                    continue;
+                }
+                if (!isDirectory) {
+                    found.push_back({ move(file), move(relative), false, nullptr, {}, nullptr });
+                }
+                else if (!entry.is_symlink(typeError)) {
+                    found.push_back({ move(file), move(relative), true, filter,
+                        directory.canonical / entry.path().filename(), directory.hops });
+                }
+                else {
+                    fs::path target = fs::canonical(entry.path(), typeError);
+                    if (typeError || leads_back(target, directory)) {
+                        skipped++;
+                        continue;
+                    }
+                    found.push_back({ move(file), move(relative), true, filter, move(target),
+                        make_shared<LinkHop>(LinkHop{ directory.canonical, directory.hops }) });
+                }
+            }
+
+            lock_guard<mutex> guard(lock);
+            summary.directories++;
+            summary.skippedLinks += skipped;
+            summary.ignored += ignored;
+            if (!readable || error) {
+                summary.unreadable++;
+            }
+            for (Task& task : found) {
+                if (task.directory) {
+                    tasks.push_back(move(task));
+                }
+                else {
+                    summary.files++;
+                    tasks.push_front(move(task));
+                }
+            }
+            pending += found.size();
+            if (!found.empty()) {
+                ready.notify_all();
+            }
+        }
+
+        // True if a link target is, or contains, a directory on the way from the root to the
+        // link; following it would loop. It only depends on that way, not on what other workers
+        // have walked, so every run visits the same files.
+        static bool leads_back(const fs::path& target, const Task& directory) {
+            if (contains(target, directory.canonical)) {
+                return true;
+            }
+            // The directories between two hops are real ones, so the deepest of them stands for all
+            for (const LinkHop* hop = directory.hops.get(); hop; hop = hop->previous.get()) {
+                if (contains(target, hop->from)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        const WalkOptions& options;
+        const function<void(const string&, unsigned)>& visit;
+
+        mutex lock;
+        condition_variable ready;
+        deque<Task> tasks;
+        size_t pending = 0;             ///< Tasks queued or running
+        WalkSummary summary;
+    };
+}
+
+
+WalkSummary walk_source_tree(const string& root, const WalkOptions& options,
+    const function<void(const string& path, unsigned worker)>& visit) {
+    TreeWalk walk(options, visit);
+    return walk.run(root);
+}
+
+void visit_files(const vector<string>& files, const WalkOptions& options,
+    const function<void(const string& path, unsigned worker)>& visit) {
+    visit_indexes(files.size(), options, [&](size_t index, unsigned worker) {
+        visit(files[index], worker);
+    });
+}
+
+void visit_indexes(size_t count, const WalkOptions& options,
+    const function<void(size_t index, unsigned worker)>& visit) {
+    atomic<size_t> next{ 0 };
+    vector<thread> workers;
+    unsigned threads = static_cast<unsigned>(min<size_t>(walk_thread_count(options), max<size_t>(count, 1)));
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([&, i] {
+            for (size_t index = next++; index < count; index = next++) {
+                visit(index, i);
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
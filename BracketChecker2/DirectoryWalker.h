@@ -0,0 +1,134 @@
+/**
+ * @file DirectoryWalker.h
+ * @brief Parallel recursive walk of a source tree.
+ *
+ * walk_source_tree() lists directories on a pool of threads, one task per
+ * directory. Every matching file found becomes a task of its own on the same
+ * pool, so checking starts as soon as the first directory is listed and a
+ * large flat directory is still checked in parallel. Ignored directories
+ * are pruned before they are listed:
+ * @code
+ * walk_source_tree("src", options, [&](const string& path, unsigned worker) {
+ *     check(path, workerState[worker]);
+ * });
+ * @endcode
+ */
+
+#pragma once
+#ifndef DIRECTORYWALKER_H
+#define DIRECTORYWALKER_H
+
+#include <cstdint>
+#include <functional>
+#include "BracketChecker2.h"
+#include "PathFilter.h"
+
+
+/**
+ * @brief Extensions checked by default: .cpp, .cc, .h, .hpp and .inl.
+ */
+vector<string> default_source_extensions();
+
+
+/**
+ * @brief Splits a comma-separated list such as ".cpp,.h" into extensions.
+ *
+ * A missing leading dot is added, so "cpp,h" means the same.
+ */
+vector<string> parse_extension_list(const string& list);
+
+
+/**
+ * @brief True if the file name ends in one of the extensions.
+ * @param path [in] Path of the file.
+ * @param extensions [in] Extensions including the dot, compared case-sensitively.
+ */
+bool has_source_extension(const string& path, const vector<string>& extensions);
+
+
+/**
+ * @struct WalkOptions
+ * @brief What walk_source_tree() visits and with how many threads.
+ */
+struct WalkOptions {
+    vector<string> extensions = default_source_extensions();
+    unsigned threads = 0;          ///< Worker threads; 0 uses the number of hardware threads
+    PathFilter exclude;            ///< Paths relative to the root that are never listed or visited
+    bool readIgnoreFiles = true;   ///< Also apply the .gitignore file of each walked directory
+};
+
+
+/**
+ * @struct WalkSummary
+ * @brief Counts of one walk.
+ */
+struct WalkSummary {
+    uint64_t directories = 0;   ///< Directories listed, the root included
+    uint64_t files = 0;         ///< Files passed to the visitor
+    uint64_t skippedLinks = 0;  ///< Directory links skipped because they lead back above themselves
+    uint64_t unreadable = 0;    ///< Directories that could not be listed
+    uint64_t ignored = 0;       ///< Files and directories excluded by the filter
+};
+
+
+/**
+ * @brief Visits every file below a directory whose extension is in the options.
+ *
+ * Symbolic links to directories are followed unless their target is, or
+ * contains, a directory on the way from the root to the link; this skips
+ * link loops. The choice depends only on that way, so every run visits the
+ * same files; a directory reached through several links is visited under
+ * each of their paths. Directories that cannot be listed are counted and
+ * skipped.
+ *
+ * Entries matched by WalkOptions::exclude, or by a .gitignore file of their
+ * directory or of a directory above, are skipped when their directory is
+ * listed; an excluded directory is never opened, and neither is a
+ * directory named .git.
+ *
+ * The visitor runs concurrently on the worker threads, never twice at once
+ * with the same worker index; per-worker state indexed by it needs no lock.
+ * The order of the visits is unspecified. The function returns when every
+ * visit has finished.
+ *
+ * @param root [in] Directory to walk.
+ * @param options [in] Extensions and number of threads.
+ * @param visit [in] Called with the path of each file, as root joined with the relative path, and the worker index below WalkOptions::threads (or the hardware thread count).
+ * @return Counts of the walk.
+ */
+WalkSummary walk_source_tree(const string& root, const WalkOptions& options,
+    const function<void(const string& path, unsigned worker)>& visit);
+
+
+/**
+ * @brief Visits a given list of files on the worker threads of a walk.
+ *
+ * For file lists that are known in advance, such as the sources of a
+ * compilation database. The visitor is called as by walk_source_tree();
+ * the extensions and the filters of the options are not applied.
+ *
+ * @param files [in] Paths to visit.
+ * @param options [in] Number of threads.
+ * @param visit [in] Called with each path and the worker index.
+ */
+void visit_files(const vector<string>& files, const WalkOptions& options,
+    const function<void(const string& path, unsigned worker)>& visit);
+
+
+/**
+ * @brief Calls a function for each index below a count on the worker threads of a walk.
+ * @param count [in] Number of indexes.
+ * @param options [in] Number of threads.
+ * @param visit [in] Called with each index and the worker index.
+ */
+void visit_indexes(size_t count, const WalkOptions& options,
+    const function<void(size_t index, unsigned worker)>& visit);
+
+
+/**
+ * @brief Number of workers walk_source_tree() starts for the options.
+ */
+unsigned walk_thread_count(const WalkOptions& options);
+
+
+#endif // DIRECTORYWALKER_H
@@ -0,0 +1,589 @@
+/**
+ * @file GitSource.cpp
+ * @brief Implementation of the git process, diff and blob reading.
+ */
+#include "GitSource.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+
+/**
+ * @class GitProcess
+ * @brief A git child process with pipes to its standard input and output.
+ */
+class GitProcess {
+public:
+    GitProcess() = default;
+
+    ~GitProcess() {
+        close_input();
+        wait();
+    }
+
+    GitProcess(const GitProcess&) = delete;
+    GitProcess& operator=(const GitProcess&) = delete;
+
+    /**
+     * @brief Starts git with the arguments; standard error is inherited.
+     */
+    bool start(const vector<string>& args);
+
+    /// Writes all of the data to the standard input of git.
+    bool write(string_view data);
+
+    /// Reads up to the next '\n', which is not stored.
+    bool read_line(string& line) {
+        line.clear();
+        while (true) {
+            if (pos == end && !fill()) {
+                return false;
+            }
+            const char* newline = static_cast<const char*>(memchr(buffer + pos, '\n', end - pos));
+            size_t stop = newline ? static_cast<size_t>(newline - buffer) : end;
+            line.append(buffer + pos, stop - pos);
+            pos = stop;
+            if (newline) {
+                pos++;
+                return true;
+            }
+        }
+    }
+
+    /// Reads exactly count bytes.
+    bool read_bytes(size_t count, string& out) {
+        out.resize(count);
+        size_t used = 0;
+        while (used < count) {
+            if (pos == end && !fill()) {
+                out.resize(used);
+                return false;
+            }
+            size_t chunk = min(count - used, end - pos);
+            memcpy(&out[used], buffer + pos, chunk);
+            pos += chunk;
+            used += chunk;
+        }
+        return true;
+    }
+
+    /// Reads until git closes its standard output.
+    void read_all(string& out) {
+        out.clear();
+        while (pos < end || fill()) {
+            out.append(buffer + pos, end - pos);
+            pos = end;
+        }
+    }
+
+    /// Closes the standard input, so a batch command finishes.
+    void close_input();
+
+    /// Waits for git to exit; the exit status, or -1 if it did not run or was killed.
+    int wait();
+
+private:
+    bool fill();
+
+#ifdef _WIN32
+    HANDLE input = nullptr;
+    HANDLE output = nullptr;
+    HANDLE process = nullptr;
+#else
+    int input = -1;
+    int output = -1;
+    pid_t pid = -1;
+#endif
+    int status = -1;
+    char buffer[BUDGET_CHECK_INTERVAL];
+    size_t pos = 0;
+    size_t end = 0;
+};
+
+
+namespace {
+    // Held while pipes are created and handed to a child, so a git started on
+    // another thread does not inherit them and keep them open after we close ours
+    mutex spawnLock;
+}
+
+
+#ifdef _WIN32
+namespace {
+    // Quotes an argument the way the Microsoft C runtime splits command lines
+    string quote_argument(const string& arg) {
+        if (!arg.empty() && arg.find_first_of(" \t\"") == string::npos) {
+            return arg;
+        }
+        string quoted = "\"";
+        size_t backslashes = 0;
+        for (char ch : arg) {
+            if (ch == '\\') {
+                backslashes++;
+                continue;
+            }
+            quoted.append(ch == '"' ? 2 * backslashes + 1 : backslashes, '\\');
+            backslashes = 0;
+            quoted += ch;
+        }
+        quoted.append(2 * backslashes, '\\');
+        return quoted + "\"";
+    }
+}
+
+bool GitProcess::start(const vector<string>& args) {
+    lock_guard<mutex> guard(spawnLock);
+    SECURITY_ATTRIBUTES inherit = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+    HANDLE childInput = nullptr;
+    HANDLE childOutput = nullptr;
+    if (!CreatePipe(&childInput, &input, &inherit, 0)) {
+        return false;
+    }
+    if (!CreatePipe(&output, &childOutput, &inherit, 0)) {
+        CloseHandle(childInput);
+        CloseHandle(input);
+        input = nullptr;
+        return false;
+    }
+    // Only the child's ends are inherited
+    SetHandleInformation(input, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(output, HANDLE_FLAG_INHERIT, 0);
+
+    string commandLine = "git";
+    for (const string& arg : args) {
+        commandLine += " " + quote_argument(arg);
+    }
+    STARTUPINFOA startup = {};
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = childInput;
+    startup.hStdOutput = childOutput;
+    startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    PROCESS_INFORMATION info = {};
+    bool started = CreateProcessA(nullptr, &commandLine[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW,
+        nullptr, nullptr, &startup, &info) != 0;
+    CloseHandle(childInput);
+    CloseHandle(childOutput);
+    if (!started) {
+        CloseHandle(input);
+        CloseHandle(output);
+        input = output = nullptr;
+        return false;
+    }
+    CloseHandle(info.hThread);
+    process = info.hProcess;
+    return true;
+}
+
+bool GitProcess::write(string_view data) {
+    while (!data.empty()) {
+        DWORD written = 0;
+        DWORD chunk = static_cast<DWORD>(min<size_t>(data.size(), 1u << 20));
+        if (!input || !WriteFile(input, data.data(), chunk, &written, nullptr)) {
+            return false;
+        }
+        data.remove_prefix(written);
+    }
+    return true;
+}
+
+bool GitProcess::fill() {
+    DWORD count = 0;
+    if (!output || !ReadFile(output, buffer, sizeof(buffer), &count, nullptr) || count == 0) {
+        return false;
+    }
+    pos = 0;
+    end = count;
+    return true;
+}
+
+void GitProcess::close_input() {
+    if (input) {
+        CloseHandle(input);
+        input = nullptr;
+    }
+}
+
+int GitProcess::wait() {
+    if (process) {
+        if (output) {
+            CloseHandle(output);
+            output = nullptr;
+        }
+        WaitForSingleObject(process, INFINITE);
+        DWORD code = 0;
+        status = GetExitCodeProcess(process, &code) ? static_cast<int>(code) : -1;
+        CloseHandle(process);
+        process = nullptr;
+    }
+    return status;
+}
+
+#else
+
+bool GitProcess::start(const vector<string>& args) {
+    // Writing to a git that has exited must fail with EPIPE instead of killing the checker
+    static bool ignoreSigpipe = (signal(SIGPIPE, SIG_IGN), true);
+    (void)ignoreSigpipe;
+
+    lock_guard<mutex> guard(spawnLock);
+    int toChild[2];
+    int fromChild[2];
+    if (pipe(toChild) != 0) {
+        return false;
+    }
+    if (pipe(fromChild) != 0) {
+        close(toChild[0]);
+        close(toChild[1]);
+        return false;
+    }
+    // The child gets its ends through dup2, which clears the flag on the copies
+    for (int fd : { toChild[0], toChild[1], fromChild[0], fromChild[1] }) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    vector<char*> argv;
+    argv.push_back(const_cast<char*>("git"));
+    for (const string& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, toChild[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fromChild[1], STDOUT_FILENO);
+    for (int fd : { toChild[0], toChild[1], fromChild[0], fromChild[1] }) {
+        posix_spawn_file_actions_addclose(&actions, fd);
+    }
+    bool started = posix_spawnp(&pid, "git", &actions, nullptr, argv.data(), environ) == 0;
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(toChild[0]);
+    close(fromChild[1]);
+    if (!started) {
+        close(toChild[1]);
+        close(fromChild[0]);
+        pid = -1;
+        return false;
+    }
+    input = toChild[1];
+    output = fromChild[0];
+    return true;
+}
+
+bool GitProcess::write(string_view data) {
+    while (!data.empty()) {
+        ssize_t written = input >= 0 ? ::write(input, data.data(), data.size()) : -1;
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+bool GitProcess::fill() {
+    while (output >= 0) {
+        ssize_t count = ::read(output, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        pos = 0;
+        end = static_cast<size_t>(count);
+        return true;
+    }
+    return false;
+}
+
+void GitProcess::close_input() {
+    if (input >= 0) {
+        close(input);
+        input = -1;
+    }
+}
+
+int GitProcess::wait() {
+    if (pid > 0) {
+        if (output >= 0) {
+            close(output);
+            output = -1;
+        }
+        int waitStatus = 0;
+        while (waitpid(pid, &waitStatus, 0) < 0 && errno == EINTR) {
+        }
+        status = WIFEXITED(waitStatus) ? WEXITSTATUS(waitStatus) : -1;
+        pid = -1;
+    }
+    return status;
+}
+
+#endif
+
+
+bool split_revision_range(const string& range, string& base, string& head) {
+    size_t dots = range.find("..");
+    if (dots == string::npos || range.compare(dots, 3, "...") == 0) {
+        return false;
+    }
+    base = range.substr(0, dots);
+    head = range.substr(dots + 2);
+    // A leading '-' would be taken as an option by git
+    return !base.empty() && !head.empty() && base[0] != '-' && head[0] != '-';
+}
+
+bool run_git(const string& repository, const vector<string>& args, string& output, string& error,
+    const string& input) {
+    vector<string> fullArgs = { "-C", repository };
+    fullArgs.insert(fullArgs.end(), args.begin(), args.end());
+    GitProcess git;
+    if (!git.start(fullArgs)) {
+        error = "Cannot run git";
+        return false;
+    }
+    // Input is written on its own thread, so git never waits on a full output pipe while we write
+    thread writer;
+    if (input.empty()) {
+        git.close_input();
+    }
+    else {
+        writer = thread([&git, &input] {
+            git.write(input);
+            git.close_input();
+        });
+    }
+    git.read_all(output);
+    if (writer.joinable()) {
+        writer.join();
+    }
+    int status = git.wait();
+    if (status != 0) {
+        error = "git " + args.front() + " failed with exit status " + to_string(status);
+        return false;
+    }
+    return true;
+}
+
+
+namespace {
+    /**
+     * @struct RawEntry
+     * @brief One file of `git diff-tree -z` output.
+     */
+    struct RawEntry {
+        string oldId;
+        string newId;
+        char status = '\0';
+        bool regularFile = false;  ///< New mode is 100644 or 100755
+        string path;
+    };
+
+    // Parses ":oldmode newmode oldid newid status" NUL path NUL at pos; a rename or copy
+    // has its source path first and keeps the destination
+    bool parse_raw_entry(const string& output, size_t& pos, RawEntry& entry) {
+        size_t metaEnd = output.find('\0', pos);
+        size_t pathEnd = metaEnd == string::npos ? string::npos : output.find('\0', metaEnd + 1);
+        if (pathEnd == string::npos || output[pos] != ':') {
+            return false;
+        }
+        string_view meta(output.data() + pos + 1, metaEnd - pos - 1);
+
+        size_t fields[4] = {};
+        size_t field = 0;
+        for (size_t i = 0; i < meta.size() && field < 4; i++) {
+            if (meta[i] == ' ') {
+                fields[field++] = i + 1;
+            }
+        }
+        if (field < 4 || fields[3] >= meta.size()) {
+            return false;
+        }
+        entry.regularFile = meta.compare(fields[0], 3, "100") == 0;
+        entry.oldId = meta.substr(fields[1], fields[2] - fields[1] - 1);
+        entry.newId = meta.substr(fields[2], fields[3] - fields[2] - 1);
+        entry.status = meta[fields[3]];
+
+        size_t pathStart = metaEnd + 1;
+        if (entry.status == 'R' || entry.status == 'C') {
+            pathStart = pathEnd + 1;
+            pathEnd = output.find('\0', pathStart);
+            if (pathEnd == string::npos) {
+                return false;
+            }
+        }
+        entry.path = output.substr(pathStart, pathEnd - pathStart);
+        pos = pathEnd + 1;
+        return true;
+    }
+
+    // Splits output at the separator, dropping empty pieces
+    vector<string> split_output(const string& output, char separator) {
+        vector<string> pieces;
+        size_t pos = 0;
+        while (pos < output.size()) {
+            size_t end = output.find(separator, pos);
+            if (end == string::npos) {
+                end = output.size();
+            }
+            if (end > pos) {
+                pieces.push_back(output.substr(pos, end - pos));
+            }
+            pos = end + 1;
+        }
+        return pieces;
+    }
+}
+
+
+bool list_changed_files(const string& repository, const string& base, const string& head,
+    vector<GitChange>& changes, string& error) {
+    changes.clear();
+    string output;
+    if (!run_git(repository, { "diff-tree", "-r", "-z", "--find-renames", "--no-commit-id", base, head }, output, error)) {
+        return false;
+    }
+
+    RawEntry entry;
+    size_t pos = 0;
+    while (pos < output.size()) {
+        if (!parse_raw_entry(output, pos, entry)) {
+            error = "Unexpected output of git diff-tree";
+            return false;
+        }
+        // A pure rename or a mode change keeps the file's own contents
+        if (entry.status != 'D' && entry.regularFile && entry.newId != entry.oldId) {
+            changes.push_back({ move(entry.path), move(entry.newId) });
+        }
+    }
+    return true;
+}
+
+bool list_history(const string& repository, const string& range, vector<GitChange>& baseline,
+    vector<GitCommitChanges>& commits, string& error) {
+    baseline.clear();
+    commits.clear();
+    if (range.empty() || range[0] == '-') {
+        error = "Invalid revision range " + range;
+        return false;
+    }
+    string output;
+    if (!run_git(repository, { "rev-list", "--first-parent", "--reverse", range }, output, error)) {
+        return false;
+    }
+    vector<string> ids = split_output(output, '\n');
+    if (ids.empty()) {
+        return true;
+    }
+
+    // The files before the first commit; a root commit starts from no files
+    string parent;
+    string ignored;
+    if (run_git(repository, { "rev-parse", "--verify", "-q", ids.front() + "^" }, output, ignored)) {
+        parent = output.substr(0, output.find('\n'));
+        if (!run_git(repository, { "ls-tree", "-r", "-z", "--full-tree", parent }, output, error)) {
+            return false;
+        }
+        // Each entry is "mode type id" TAB path
+        for (const string& line : split_output(output, '\0')) {
+            size_t tab = line.find('\t');
+            size_t idStart = line.rfind(' ', tab);
+            if (tab == string::npos || idStart == string::npos) {
+                error = "Unexpected output of git ls-tree";
+                return false;
+            }
+            if (line.compare(0, 3, "100") == 0) {
+                baseline.push_back({ line.substr(tab + 1), line.substr(idStart + 1, tab - idStart - 1) });
+            }
+        }
+    }
+
+    // One diff-tree for all commits, each against its predecessor in the walk
+    string input;
+    for (size_t i = 0; i < ids.size(); i++) {
+        const string& previous = i > 0 ? ids[i - 1] : parent;
+        input += previous.empty() ? ids[i] + "\n" : ids[i] + " " + previous + "\n";
+    }
+    if (!run_git(repository, { "diff-tree", "--stdin", "--always", "--root", "-r", "-z", "--no-renames" },
+        output, error, input)) {
+        return false;
+    }
+    RawEntry entry;
+    size_t pos = 0;
+    while (pos < output.size()) {
+        if (output[pos] != ':') {
+            // A commit id line starts the changes of the next commit
+            size_t end = output.find('\0', pos);
+            if (end == string::npos) {
+                end = output.size();
+            }
+            commits.push_back({ output.substr(pos, end - pos), {} });
+            pos = end + 1;
+            continue;
+        }
+        if (commits.empty() || !parse_raw_entry(output, pos, entry)) {
+            error = "Unexpected output of git diff-tree";
+            return false;
+        }
+        bool present = entry.status != 'D' && entry.regularFile;
+        commits.back().changes.push_back({ move(entry.path), present ? move(entry.newId) : string() });
+    }
+    return true;
+}
+
+
+GitBlobReader::GitBlobReader(const string& repository) : process(make_unique<GitProcess>()) {
+    if (!process->start({ "-C", repository, "cat-file", "--batch" })) {
+        process.reset();
+    }
+}
+
+GitBlobReader::~GitBlobReader() = default;
+
+bool GitBlobReader::running() const {
+    return process != nullptr;
+}
+
+bool GitBlobReader::read(const string& blobId, string& contents) {
+    contents.clear();
+    if (!process || blobId.empty() || blobId.find_first_of(" \n") != string::npos) {
+        return false;
+    }
+    // The answer is "<id> blob <size>" and the contents, or "<id> missing"
+    string header;
+    if (!process->write(blobId + "\n") || !process->read_line(header)) {
+        return false;
+    }
+    size_t typeStart = header.find(' ');
+    size_t sizeStart = typeStart == string::npos ? string::npos : header.find(' ', typeStart + 1);
+    if (sizeStart == string::npos) {
+        return false;
+    }
+    size_t size = static_cast<size_t>(strtoull(header.c_str() + sizeStart + 1, nullptr, 10));
+    string newline;
+    bool complete = process->read_bytes(size, contents) && process->read_bytes(1, newline);
+    return complete && header.compare(typeStart, sizeStart - typeStart, " blob") == 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * @file GitSource.h
+ * @brief Files of a git repository read from its object database.
+ *
+ * Pre-merge checks care about the files a commit range changes, as they are
+ * in the head commit, not as they are in the working tree. The changed
+ * paths come from `git diff-tree`; their contents are streamed from one
+ * long-lived `git cat-file --batch` process, so a range with thousands of
+ * changed files starts two processes in total and writes no temporary
+ * files. A history of many commits is listed the same way, with one
+ * diff-tree fed every commit. Only the local repository is read; nothing
+ * is fetched.
+ */
+
+#pragma once
+#ifndef GITSOURCE_H
+#define GITSOURCE_H
+
+#include "BracketChecker2.h"
+
+
+/**
+ * @struct GitChange
+ * @brief A file whose contents differ between two revisions.
+ */
+struct GitChange {
+    string path;    ///< Path relative to the top of the repository, '/'-separated
+    string blobId;  ///< Object id of the contents in the head revision
+};
+
+
+/**
+ * @brief Splits "base..head" into its two revisions.
+ * @return False if there is no "..", a side is empty, or a side starts with '-'.
+ */
+bool split_revision_range(const string& range, string& base, string& head);
+
+
+/**
+ * @brief Runs a git command in a repository and collects its output.
+ * @param repository [in] Directory inside the repository, passed as `git -C`.
+ * @param args [in] Arguments after `git -C repository`.
+ * @param output [out] Standard output of the command; its standard error is passed through.
+ * @param error [out] Why the command failed.
+ * @param input [in] Written to the standard input of the command.
+ * @return False if git cannot be started or exits with a non-zero status.
+ */
+bool run_git(const string& repository, const vector<string>& args, string& output, string& error,
+    const string& input = "");
+
+
+/**
+ * @brief Lists the files added or modified between two revisions.
+ *
+ * Deleted files, submodules and symbolic links are left out, and so is a
+ * file whose own contents did not change: one that is only renamed or
+ * changed in mode. A new file is listed even if its contents equal those of
+ * another file of the base revision.
+ *
+ * @param repository [in] Directory inside the repository.
+ * @param base [in] Base revision.
+ * @param head [in] Head revision.
+ * @param changes [out] Changed files in the order git reports them.
+ * @param error [out] Why the list could not be read.
+ * @return False if git fails, e.g. because a revision does not exist.
+ */
+bool list_changed_files(const string& repository, const string& base, const string& head,
+    vector<GitChange>& changes, string& error);
+
+
+/**
+ * @struct GitCommitChanges
+ * @brief Files a commit changed relative to the previous commit of a walk.
+ */
+struct GitCommitChanges {
+    string commit;              ///< Object id of the commit
+    vector<GitChange> changes;  ///< blobId is empty for a file that was deleted or is no longer a regular file
+};
+
+
+/**
+ * @brief Lists the changes of every commit in a range, oldest first.
+ *
+ * The walk follows first parents only, so the commits form one line and
+ * each is compared with the one before it; a merge shows what it brought
+ * into the branch. The files before the first commit are listed in
+ * @p baseline. Three git processes run whatever the number of commits:
+ * rev-list, ls-tree for the baseline, and one diff-tree fed all commits.
+ *
+ * @param repository [in] Directory inside the repository.
+ * @param range [in] Revision range as accepted by `git rev-list`, e.g. "v1.0..main".
+ * @param baseline [out] Regular files before the first commit, empty for a root commit.
+ * @param commits [out] Commits in the range, oldest first, with their changes.
+ * @param error [out] Why the history could not be read.
+ * @return False if git fails or the range starts with '-'.
+ */
+bool list_history(const string& repository, const string& range, vector<GitChange>& baseline,
+    vector<GitCommitChanges>& commits, string& error);
+
+
+class GitProcess;
+
+/**
+ * @class GitBlobReader
+ * @brief Reads blobs through one `git cat-file --batch` process.
+ *
+ * Blobs are requested one at a time and git flushes each answer, so
+ * requests and answers never block each other. Not thread-safe.
+ */
+class GitBlobReader {
+public:
+    /**
+     * @brief Starts `git cat-file --batch` in the repository.
+     */
+    explicit GitBlobReader(const string& repository);
+
+    /**
+     * @brief Ends the git process.
+     */
+    ~GitBlobReader();
+
+    GitBlobReader(const GitBlobReader&) = delete;
+    GitBlobReader& operator=(const GitBlobReader&) = delete;
+
+    /**
+     * @brief True if the git process could be started.
+     */
+    bool running() const;
+
+    /**
+     * @brief Reads the contents of a blob.
+     * @param blobId [in] Object id of the blob.
+     * @param contents [out] Raw bytes of the blob, reusing the capacity of the string.
+     * @return False if the object is missing, is not a blob, or git has exited.
+     */
+    bool read(const string& blobId, string& contents);
+
+private:
+    unique_ptr<GitProcess> process;
+};
+
+
+#endif // GITSOURCE_H
@@ -0,0 +1,147 @@
+/**
+ * @file LatencyReport.cpp
+ * @brief Implementation of the latency histogram and the file lists.
+ */
+#include "LatencyReport.h"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+
+
+LatencyHistogram::LatencyHistogram() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, memory_order_relaxed);
+    }
+}
+
+// Values below 2^SUB_BUCKET_BITS get a bucket each; larger ones share one per sub-range
+size_t LatencyHistogram::bucket_index(uint64_t value) {
+    const uint64_t subBuckets = uint64_t(1) << SUB_BUCKET_BITS;
+    if (value < subBuckets) {
+        return static_cast<size_t>(value);
+    }
+    // The leading one and the SUB_BUCKET_BITS bits after it select the bucket
+    unsigned shift = static_cast<unsigned>(bit_width(value)) - 1 - SUB_BUCKET_BITS;
+    size_t sub = static_cast<size_t>((value >> shift) & (subBuckets - 1));
+    return (static_cast<size_t>(shift + 1) << SUB_BUCKET_BITS) | sub;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index) {
+    const uint64_t subBuckets = uint64_t(1) << SUB_BUCKET_BITS;
+    if (index < subBuckets) {
+        return index;
+    }
+    unsigned shift = static_cast<unsigned>(index >> SUB_BUCKET_BITS) - 1;
+    uint64_t lower = (subBuckets + (index & (subBuckets - 1))) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    buckets[bucket_index(nanoseconds)].fetch_add(1, memory_order_relaxed);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        uint64_t count = other.buckets[i].load(memory_order_relaxed);
+        if (count) {
+            buckets[i].fetch_add(count, memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (const auto& bucket : buckets) {
+        total += bucket.load(memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    // Rank of the requested value, 1-based
+    uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(total) + 0.5);
+    rank = min(max(rank, uint64_t(1)), total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i].load(memory_order_relaxed);
+        if (seen >= rank) {
+            return bucket_upper_bound(i);
+        }
+    }
+    return bucket_upper_bound(BUCKET_COUNT - 1);
+}
+
+
+TopFiles::TopFiles(size_t limit) : limit(limit) {
+}
+
+// Inserts into a list sorted by the given order, keeping at most limit entries
+template <class Before>
+static void insert_top(vector<FileTiming>& list, size_t limit, const FileTiming& file, Before before) {
+    if (limit == 0 || (list.size() == limit && !before(file, list.back()))) {
+        return;
+    }
+    list.insert(upper_bound(list.begin(), list.end(), file, before), file);
+    if (list.size() > limit) {
+        list.pop_back();
+    }
+}
+
+void TopFiles::add(const FileTiming& file) {
+    insert_top(slowestFiles, limit, file,
+        [](const FileTiming& a, const FileTiming& b) { return a.seconds > b.seconds; });
+    insert_top(largestFiles, limit, file,
+        [](const FileTiming& a, const FileTiming& b) { return a.bytes > b.bytes; });
+}
+
+void TopFiles::merge(const TopFiles& other) {
+    for (const FileTiming& file : other.slowestFiles) {
+        insert_top(slowestFiles, limit, file,
+            [](const FileTiming& a, const FileTiming& b) { return a.seconds > b.seconds; });
+    }
+    for (const FileTiming& file : other.largestFiles) {
+        insert_top(largestFiles, limit, file,
+            [](const FileTiming& a, const FileTiming& b) { return a.bytes > b.bytes; });
+    }
+}
+
+
+// Writes one file with its phase breakdown
+static void print_file_timing(ostream& out, const FileTiming& file) {
+    out << "  " << setw(10) << file.seconds * 1e3 << " ms " << setw(10) << file.bytes << " B  ";
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        out << phase_name(static_cast<CheckPhase>(i)) << "=" << file.phaseSeconds[i] * 1e3 << " ";
+    }
+    out << file.path << endl;
+}
+
+void print_latency_report(ostream& out, const LatencyHistogram& histogram, const TopFiles& files) {
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+    out << fixed << setprecision(3);
+
+    out << "Files: " << histogram.count() << ", latency ms:";
+    const double fractions[] = { 0.5, 0.9, 0.99, 0.999 };
+    const char* const labels[] = { "p50", "p90", "p99", "p99.9" };
+    for (size_t i = 0; i < 4; i++) {
+        out << " " << labels[i] << "=" << static_cast<double>(histogram.percentile(fractions[i])) / 1e6;
+    }
+    out << endl;
+
+    out << "Slowest files:" << endl;
+    for (const FileTiming& file : files.slowest()) {
+        print_file_timing(out, file);
+    }
+    out << "Largest files:" << endl;
+    for (const FileTiming& file : files.largest()) {
+        print_file_timing(out, file);
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,123 @@
+/**
+ * @file LatencyReport.h
+ * @brief Per-file latency histogram and slowest/largest file lists.
+ *
+ * LatencyHistogram buckets latencies logarithmically like an HDR histogram:
+ * every power of two is split into 32 linear sub-buckets, so any recorded
+ * value is known within about 3% while the whole range from 1 ns to hours
+ * fits in 2048 counters. Recording is a relaxed atomic increment, so worker
+ * threads can share one histogram without locks. TopFiles is kept per
+ * worker and merged when the workers are done.
+ */
+
+#pragma once
+#ifndef LATENCYREPORT_H
+#define LATENCYREPORT_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include "CheckStats.h"
+
+
+/**
+ * @class LatencyHistogram
+ * @brief Log-bucketed histogram of nanosecond latencies.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    /**
+     * @brief Adds one latency; safe to call from several threads at once.
+     * @param nanoseconds [in] Latency to record.
+     */
+    void record(uint64_t nanoseconds);
+
+    /**
+     * @brief Adds the counts of another histogram.
+     * @param other [in] Histogram to add; may be updated concurrently.
+     */
+    void merge(const LatencyHistogram& other);
+
+    /**
+     * @brief Number of recorded latencies.
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Latency below which the given share of the values lies.
+     * @param fraction [in] Share in [0, 1], e.g. 0.99 for p99.
+     * @return Upper bound of the bucket holding that value in nanoseconds, 0 if empty.
+     */
+    uint64_t percentile(double fraction) const;
+
+private:
+    static const unsigned SUB_BUCKET_BITS = 5;
+    static const size_t BUCKET_COUNT = size_t(64) << SUB_BUCKET_BITS;
+
+    static size_t bucket_index(uint64_t value);
+    static uint64_t bucket_upper_bound(size_t index);
+
+    atomic<uint64_t> buckets[BUCKET_COUNT];
+};
+
+
+/**
+ * @struct FileTiming
+ * @brief Latency and phase breakdown of one checked file.
+ */
+struct FileTiming {
+    string path;
+    uint64_t bytes = 0;
+    double seconds = 0;                 ///< Wall time of the whole check
+    double phaseSeconds[PHASE_COUNT] = {};
+};
+
+
+/**
+ * @class TopFiles
+ * @brief Keeps the N slowest and the N largest files.
+ *
+ * Not thread-safe: use one instance per worker and merge() them at the end.
+ */
+class TopFiles {
+public:
+    /**
+     * @param limit [in] Number of files kept in each list.
+     */
+    explicit TopFiles(size_t limit = 10);
+
+    /**
+     * @brief Offers a file to both lists.
+     */
+    void add(const FileTiming& file);
+
+    /**
+     * @brief Offers every file of another instance.
+     */
+    void merge(const TopFiles& other);
+
+    /// Slowest files, slowest first.
+    const vector<FileTiming>& slowest() const { return slowestFiles; }
+
+    /// Largest files, largest first.
+    const vector<FileTiming>& largest() const { return largestFiles; }
+
+private:
+    size_t limit;
+    vector<FileTiming> slowestFiles;
+    vector<FileTiming> largestFiles;
+};
+
+
+/**
+ * @brief Writes percentiles and the slowest and largest files with their phase times.
+ * @param out [in,out] Destination stream.
+ * @param histogram [in] Per-file latencies.
+ * @param files [in] Slowest and largest files.
+ */
+void print_latency_report(ostream& out, const LatencyHistogram& histogram, const TopFiles& files);
+
+
+#endif // LATENCYREPORT_H
@@ -6,8 +6,9 @@
  * @file main.cpp
  * @brief Entry point for the BracketChecker2 program.
  *
- * This file contains the main function that handles user input for a C++ source file,
- * validates the file extension, checks for unmatched brackets using the BracketChecker2 module,
+ * This file contains the main function that handles user input for a C++ source file
+ * or a directory of them, selects the language rules from the file extension,
+ * checks for unmatched brackets using the BracketChecker2 module,
  * and writes the results to an output file.
  */
 
@@ -16,31 +17,780 @@
 #include <vector>
 #include <utility>
 #include <fstream>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cctype>
+#include <filesystem>
+#include <mutex>
 
 
 #include "BracketChecker2.h"
+#include "BracketCheckerEngine.h"
+#include "CheckStats.h"
+#include "CompileCommands.h"
+#include "DirectoryWalker.h"
+#include "GitSource.h"
+#include "LatencyReport.h"
+#include "PerfCounters.h"
+#include "Shard.h"
+#include "TraceLog.h"
 
 using namespace std;
 
 /**
- * @brief Checks whether a file has a .cpp extension.
+ * @struct Instruments
+ * @brief Measurements shared by all phases of a run.
+ */
+struct Instruments {
+    CheckStats stats;
+    PerfCounterGroup* counters = nullptr;   ///< Null unless --profile-counters works here
+    CounterValues phaseCounters[PHASE_COUNT];
+    LatencyHistogram latency;               ///< Per-file wall time
+    TopFiles topFiles;                      ///< Slowest and largest files with their phase times
+};
+
+
+/**
+ * @class PhaseScope
+ * @brief Times, counts and traces one phase of a check.
+ */
+class PhaseScope {
+public:
+    PhaseScope(Instruments& instruments, CheckPhase phase, const string& file)
+        : timer(instruments.stats.phases[phase]),
+          counting(instruments.counters, instruments.phaseCounters[phase]),
+          span(phase_name(phase), &file) {
+    }
+
+private:
+    PhaseTimer timer;
+    CounterScope counting;
+    TraceSpan span;
+};
+
+
+/**
+ * @class FileLatencyScope
+ * @brief Records the latency and phase breakdown of one file when it goes out of scope.
+ */
+class FileLatencyScope {
+public:
+    FileLatencyScope(Instruments& instruments, const string& file)
+        : instruments(instruments), bytesBefore(instruments.stats.bytes), start(chrono::steady_clock::now()) {
+        timing.path = file;
+        for (size_t i = 0; i < PHASE_COUNT; i++) {
+            timing.phaseSeconds[i] = instruments.stats.phases[i].wallSeconds;
+        }
+    }
+
+    ~FileLatencyScope() {
+        chrono::nanoseconds elapsed = chrono::steady_clock::now() - start;
+        timing.seconds = chrono::duration<double>(elapsed).count();
+        timing.bytes = instruments.stats.bytes - bytesBefore;
+        for (size_t i = 0; i < PHASE_COUNT; i++) {
+            timing.phaseSeconds[i] = instruments.stats.phases[i].wallSeconds - timing.phaseSeconds[i];
+        }
+        instruments.latency.record(static_cast<uint64_t>(elapsed.count()));
+        instruments.topFiles.add(timing);
+    }
+
+private:
+    Instruments& instruments;
+    uint64_t bytesBefore;
+    chrono::steady_clock::time_point start;
+    FileTiming timing;
+};
+
+
+/**
+ * @struct FileCheck
+ * @brief Outcome of checking one file.
+ */
+struct FileCheck {
+    set<BracketError> errors;     ///< Budget, validation or bracket errors, whichever ended the check
+    bool opened = true;           ///< False if the file could not be opened
+    bool invalid = false;         ///< Validation failed
+    bool budgetExceeded = false;  ///< The time, byte or depth budget ran out
+};
+
+
+/**
+ * @brief Reads, validates and parses one file.
+ *
+ * Every allocation of the check comes from the calling thread's arena (see
+ * thread_arena()), which is released when the file is done, so worker
+ * threads do not contend in the global allocator.
+ * @param inputFile [in] Source file to check.
+ * @param language [in] Language rules of the source.
+ * @param budget [in,out] Time and byte budget of the file.
+ * @param instruments [in,out] Statistics and counters of the run.
+ * @param fileSpan [in,out] Trace span of the file, given its size and error count.
+ * @return Errors and outcome of the check.
+ */
+static FileCheck check_source(const string& inputFile, SourceLanguage language, CheckBudget& budget,
+    Instruments& instruments, TraceSpan& fileSpan) {
+    CheckStats& stats = instruments.stats;
+    FileCheck check;
+    pmr::memory_resource* arena = thread_arena();
+    {
+        pmr::vector<pmr::string> lines(arena);
+        uint64_t bytesBefore = stats.bytes;
+        {
+            PhaseScope phase(instruments, PHASE_READ, inputFile);
+            lines = read_input_file(inputFile, arena, &check.opened, &budget);
+        }
+        stats.count_input(lines);
+        fileSpan.set_bytes(stats.bytes - bytesBefore);
+        if (budget.exceeded) {
+            check.errors = { { '\0', 1, 1, BUDGET_EXCEEDED } };
+            check.budgetExceeded = true;
+        }
+        else {
+            {
+                PhaseScope phase(instruments, PHASE_VALIDATE, inputFile);
+                pmr::set<BracketError> invalid = code_validation(lines, arena);
+                check.errors.insert(invalid.begin(), invalid.end());
+            }
+            check.invalid = !check.errors.empty();
+        }
+
+        // Clean files are proven balanced by the fast scan; errors are localised only when needed
+        if (!check.budgetExceeded && !check.invalid) {
+            PhaseScope phase(instruments, PHASE_PARSE, inputFile);
+            int depth = 0;
+            if (!brackets_balanced(lines, language, &budget, &depth)) {
+                pmr::set<BracketError> errors = parse_brackets(lines, language, arena, &budget, &depth);
+                check.errors.insert(errors.begin(), errors.end());
+            }
+            stats.maxDepth = max(stats.maxDepth, depth);
+            check.budgetExceeded = budget.exceeded;
+        }
+    }
+    release_thread_arena();
+
+    stats.count_errors(check.errors);
+    fileSpan.set_errors(check.errors.size());
+    return check;
+}
+
+
+/**
+ * @brief Checks one file and writes its result file.
+ * @param inputFile [in] Source file to check.
+ * @param outputFile [in] Result file to write.
+ * @param language [in] Language rules of the source.
+ * @param budget [in,out] Time and byte budget of the file.
+ * @param instruments [in,out] Statistics and counters of the run.
+ * @return Exit status: 0 if the check completed, 1 on validation failure or budget overrun.
+ */
+static int check_input_file(const string& inputFile, const string& outputFile, SourceLanguage language,
+    CheckBudget& budget, Instruments& instruments) {
+    TraceSpan fileSpan("check", &inputFile);
+    FileLatencyScope latency(instruments, inputFile);
+    budget.start();
+
+    FileCheck check = check_source(inputFile, language, budget, instruments, fileSpan);
+    if (!check.opened) {
+        cerr << "Error: Cannot open file " << inputFile << endl;
+    }
+
+    bool written;
+    {
+        PhaseScope phase(instruments, PHASE_PRINT, inputFile);
+        written = print_result(outputFile, check.errors);
+    }
+    if (!written) {
+        cerr << "Error: Cannot open output file " << outputFile << endl;
+    }
+    if (check.budgetExceeded) {
+        cerr << "Budget exceeded. See result.txt for details." << endl;
+        return 1;
+    }
+    if (check.invalid) {
+        cerr << "Validation failed. See result.txt for details." << endl;
+        return 1;
+    }
+
+    cout << "Bracket checking complete. Results saved to " << outputFile << endl;
+    return 0;
+}
+
+
+/**
+ * @class BatchCheck
+ * @brief Checks many files on worker threads and writes one result file.
+ *
+ * Each worker has its own Instruments, which are merged into the run's at
+ * the end. The result file has one "File: path" section per file, sorted
+ * by path, so the output does not depend on the number of threads.
+ */
+class BatchCheck {
+public:
+    /**
+     * @param workerCount [in] Number of worker indexes check() is called with.
+     * @param budget [in] Budget copied for each file, whose timeout starts with the file.
+     * @param instruments [in,out] Statistics of the run; hardware counters are not collected by workers.
+     */
+    BatchCheck(unsigned workerCount, const CheckBudget& budget, Instruments& instruments)
+        : budget(budget), instruments(instruments) {
+        for (unsigned i = 0; i < workerCount; i++) {
+            workers.push_back(make_unique<Instruments>());
+            workers.back()->topFiles = instruments.topFiles;
+        }
+    }
+
+    /**
+     * @brief Checks one file; safe to call concurrently with different workers.
+     */
+    void check(const string& path, unsigned worker) {
+        Instruments& local = *workers[worker];
+        SourceLanguage language = LANGUAGE_CPP;
+        language_from_extension(path, language);
+        CheckBudget fileBudget = budget;
+        fileBudget.start();
+        FileCheck check;
+        {
+            TraceSpan fileSpan("check", &path);
+            FileLatencyScope latency(local, path);
+            check = check_source(path, language, fileBudget, local, fileSpan);
+        }
+
+        lock_guard<mutex> guard(resultsLock);
+        if (!check.opened) {
+            cerr << "Error: Cannot open file " << path << endl;
+        }
+        failed = failed || !check.opened || check.invalid || check.budgetExceeded;
+        results.emplace_back(path, move(check.errors));
+    }
+
+    /**
+     * @brief Checks contents that are already in memory and returns the errors.
+     *
+     * The worker's statistics are updated as for a file, but no result is
+     * recorded. Contents that fail validation mark the run as failed.
+     * @param label [in] Name of the contents in traces and latency reports.
+     * @param contents [in] Raw file bytes.
+     * @param language [in] Language rules of the contents.
+     * @param worker [in] Worker index of the calling thread.
+     */
+    set<BracketError> check_buffer(const string& label, string_view contents, SourceLanguage language, unsigned worker) {
+        Instruments& local = *workers[worker];
+        CheckStats& stats = local.stats;
+        thread_local BracketChecker checker;
+        CheckBudget fileBudget = budget;
+        fileBudget.start();
+        set<BracketError> errors;
+        {
+            TraceSpan fileSpan("check", &label);
+            FileLatencyScope latency(local, label);
+            {
+                PhaseScope phase(local, PHASE_PARSE, label);
+                checker.set_language(language);
+                const auto& found = checker.check(contents, &fileBudget);
+                errors.insert(found.begin(), found.end());
+            }
+            stats.files++;
+            stats.lines += checker.line_count();
+            stats.bytes += contents.size();
+            stats.maxDepth = max(stats.maxDepth, checker.max_depth());
+            stats.count_errors(errors);
+            fileSpan.set_bytes(contents.size());
+            fileSpan.set_errors(errors.size());
+        }
+
+        bool invalid = any_of(errors.begin(), errors.end(), [](const BracketError& error) {
+            return error.type != WRONG_BRACKET && error.type != UNMATCHED_BRACKET;
+        });
+        if (invalid) {
+            fail();
+        }
+        return errors;
+    }
+
+    /**
+     * @brief Checks contents that are already in memory, e.g. a git blob.
+     *
+     * The contents are checked once with the worker's BracketChecker and the
+     * result is recorded for every path in @p paths, which share them.
+     * @param paths [in] Paths reported for the contents; at least one.
+     * @param contents [in] Raw file bytes.
+     * @param language [in] Language rules of the contents.
+     * @param worker [in] Worker index of the calling thread.
+     */
+    void check_contents(const vector<string>& paths, string_view contents, SourceLanguage language, unsigned worker) {
+        set<BracketError> errors = check_buffer(paths.front(), contents, language, worker);
+        lock_guard<mutex> guard(resultsLock);
+        for (const string& path : paths) {
+            results.emplace_back(path, errors);
+        }
+    }
+
+    /// Statistics of one worker, e.g. to time reads done outside check().
+    Instruments& worker_instruments(unsigned worker) { return *workers[worker]; }
+
+    /**
+     * @brief Marks the run as failed, e.g. because a directory could not be read.
+     */
+    void fail() {
+        lock_guard<mutex> guard(resultsLock);
+        failed = true;
+    }
+
+    /**
+     * @brief Merges the statistics of the workers into those of the run; called once.
+     */
+    void merge_statistics() {
+        instruments.stats.workers = static_cast<unsigned>(workers.size());
+        for (const unique_ptr<Instruments>& worker : workers) {
+            instruments.stats.merge(worker->stats);
+            instruments.latency.merge(worker->latency);
+            instruments.topFiles.merge(worker->topFiles);
+        }
+    }
+
+    /**
+     * @brief Merges the statistics and writes the result file.
+     * @param outputFile [in] Result file to write.
+     * @return Exit status: 0 if every file was checked, 1 if any file failed validation, could not be read or ran out of budget.
+     */
+    int finish(const string& outputFile) {
+        merge_statistics();
+
+        sort(results.begin(), results.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+        {
+            PhaseScope phase(instruments, PHASE_PRINT, outputFile);
+            ofstream out(outputFile);
+            if (!out) {
+                cerr << "Error: Cannot open output file " << outputFile << endl;
+                return 1;
+            }
+            for (const auto& result : results) {
+                out << "File: " << result.first << endl;
+                write_result(out, result.second);
+                out << endl;
+            }
+        }
+        return failed ? 1 : 0;
+    }
+
+    /// Number of files checked so far.
+    size_t file_count() const { return results.size(); }
+
+    /// Exit status of the checks so far: 1 if any failed.
+    int status() const { return failed ? 1 : 0; }
+
+private:
+    const CheckBudget& budget;
+    Instruments& instruments;
+    vector<unique_ptr<Instruments>> workers;
+    mutex resultsLock;
+    vector<pair<string, set<BracketError>>> results;
+    bool failed = false;
+};
+
+
+/**
+ * @brief Size of a file in bytes, 0 if it cannot be read; the weight of the file in a shard assignment.
+ */
+static uint64_t shard_weight(const string& path) {
+    error_code error;
+    uintmax_t size = filesystem::file_size(path, error);
+    return error ? 0 : static_cast<uint64_t>(size);
+}
+
+
+/**
+ * @brief Keeps the files of one shard of a run.
+ *
+ * Files are keyed by their path relative to @p base, so every machine of a
+ * CI job computes the same assignment wherever the sources are checked out.
+ * The assignment balances all files at once, so adding or removing one file
+ * can move other files to a different shard.
  *
- * This helper function is used to ensure the input file is a valid C++ source file
- * by checking its extension.
+ * @param files [in,out] Files of the whole run; on return those of the shard, in their original order.
+ * @param sizes [in] Size of each file, taken on the worker threads by the caller.
+ * @param base [in] Directory the keys are relative to.
+ * @param shard [in] Shard to keep.
+ */
+static void select_shard(vector<string>& files, const vector<uint64_t>& sizes, const string& base,
+    const ShardSpec& shard) {
+    vector<ShardFile> weighted;
+    weighted.reserve(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        weighted.push_back({ filesystem::path(files[i]).lexically_relative(base).generic_string(), sizes[i] });
+    }
+    vector<unsigned> shards = assign_shards(weighted, shard.count);
+    size_t kept = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (shards[i] == shard.index) {
+            if (kept != i) {
+                files[kept] = move(files[i]);
+            }
+            kept++;
+        }
+    }
+    files.resize(kept);
+}
+
+
+/**
+ * @brief Checks every matching file below a directory and writes one result file.
+ *
+ * Files are checked on the walker threads as they are found.
+ *
+ * @param root [in] Directory to walk.
+ * @param outputFile [in] Result file to write.
+ * @param options [in] Extensions, filters and number of threads.
+ * @param shard [in] Part of the files to check; a shard of several lists the whole tree first.
+ * @param budget [in] Budget copied for each file.
+ * @param instruments [in,out] Statistics of the run.
+ * @return Exit status: 0 if every file was checked, 1 otherwise.
+ */
+static int check_directory(const string& root, const string& outputFile, const WalkOptions& options,
+    const ShardSpec& shard, const CheckBudget& budget, Instruments& instruments) {
+    BatchCheck batch(walk_thread_count(options), budget, instruments);
+    WalkSummary summary;
+    if (shard.count == 1) {
+        summary = walk_source_tree(root, options,
+            [&](const string& path, unsigned worker) { batch.check(path, worker); });
+    }
+    else {
+        // The whole tree is listed first, as the assignment depends on every file
+        mutex filesLock;
+        vector<string> files;
+        vector<uint64_t> sizes;
+        summary = walk_source_tree(root, options, [&](const string& path, unsigned) {
+            uint64_t size = shard_weight(path);
+            lock_guard<mutex> guard(filesLock);
+            files.push_back(path);
+            sizes.push_back(size);
+        });
+        select_shard(files, sizes, root, shard);
+        visit_files(files, options, [&](const string& path, unsigned worker) { batch.check(path, worker); });
+    }
+
+    if (summary.unreadable != 0) {
+        cerr << "Warning: " << summary.unreadable << " directories could not be read." << endl;
+        batch.fail();
+    }
+    if (summary.skippedLinks != 0) {
+        cerr << "Skipped " << summary.skippedLinks << " directory links that lead back into their own path." << endl;
+    }
+    int status = batch.finish(outputFile);
+    cout << "Checked " << batch.file_count() << " files in " << summary.directories
+        << " directories. Results saved to " << outputFile << endl;
+    return status;
+}
+
+
+/**
+ * @brief Checks the source files of a compilation database and writes one result file.
+ *
+ * The files are deduplicated and checked in parallel. Exclude patterns
+ * apply to paths relative to the directory of the database; files outside
+ * it are not filtered.
+ *
+ * @param databaseFile [in] Path of compile_commands.json.
+ * @param outputFile [in] Result file to write.
+ * @param options [in] Filters and number of threads.
+ * @param shard [in] Part of the files to check, keyed relative to the directory of the database.
+ * @param budget [in] Budget copied for each file.
+ * @param instruments [in,out] Statistics of the run.
+ * @return Exit status: 0 if every file was checked, 1 otherwise.
+ */
+static int check_compile_commands(const string& databaseFile, const string& outputFile, const WalkOptions& options,
+    const ShardSpec& shard, const CheckBudget& budget, Instruments& instruments) {
+    vector<string> files;
+    string error;
+    if (!read_compile_commands(databaseFile, files, error)) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+    if (!options.exclude.empty()) {
+        filesystem::path base = filesystem::absolute(databaseFile).parent_path();
+        erase_if(files, [&](const string& file) {
+            string relative = filesystem::path(file).lexically_relative(base).generic_string();
+            return !relative.empty() && relative.compare(0, 2, "..") != 0 && options.exclude.ignored_file(relative);
+        });
+    }
+
+    if (shard.count > 1) {
+        vector<uint64_t> sizes(files.size());
+        visit_indexes(files.size(), options, [&](size_t index, unsigned) { sizes[index] = shard_weight(files[index]); });
+        select_shard(files, sizes, filesystem::absolute(databaseFile).parent_path().string(), shard);
+    }
+
+    BatchCheck batch(walk_thread_count(options), budget, instruments);
+    visit_files(files, options, [&](const string& path, unsigned worker) { batch.check(path, worker); });
+    int status = batch.finish(outputFile);
+    cout << "Checked " << batch.file_count() << " files from " << databaseFile
+        << ". Results saved to " << outputFile << endl;
+    return status;
+}
+
+
+/**
+ * @brief Checks the files changed between two revisions of a git repository.
+ *
+ * The changed paths come from `git diff-tree` and their contents, as in the
+ * head revision, from one `git cat-file --batch` process; the working tree
+ * is not read. Each distinct blob is checked once. Paths are filtered by
+ * the extensions and exclude patterns relative to the top of the repository.
+ *
+ * @param repository [in] Directory inside the repository.
+ * @param range [in] Revisions as "base..head".
+ * @param outputFile [in] Result file to write.
+ * @param options [in] Extensions and filters.
+ * @param budget [in] Budget copied for each blob.
+ * @param instruments [in,out] Statistics of the run.
+ * @return Exit status: 0 if every changed file was checked, 1 otherwise.
+ */
+static int check_git_diff(const string& repository, const string& range, const string& outputFile,
+    const WalkOptions& options, const CheckBudget& budget, Instruments& instruments) {
+    string base;
+    string head;
+    if (!split_revision_range(range, base, head)) {
+        cerr << "Error: Expected a revision range BASE..HEAD, got " << range << endl;
+        return 1;
+    }
+    vector<GitChange> changes;
+    string error;
+    if (!list_changed_files(repository, base, head, changes, error)) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+
+    // Paths with the same contents and language share one check
+    map<pair<string, SourceLanguage>, vector<string>> blobs;
+    for (GitChange& change : changes) {
+        if (!has_source_extension(change.path, options.extensions) || options.exclude.ignored_file(change.path)) {
+            continue;
+        }
+        SourceLanguage language = LANGUAGE_CPP;
+        language_from_extension(change.path, language);
+        blobs[{ change.blobId, language }].push_back(move(change.path));
+    }
+
+    GitBlobReader reader(repository);
+    if (!blobs.empty() && !reader.running()) {
+        cerr << "Error: Cannot run git cat-file" << endl;
+        return 1;
+    }
+    BatchCheck batch(1, budget, instruments);
+    string contents;
+    for (const auto& blob : blobs) {
+        bool read;
+        {
+            PhaseScope phase(instruments, PHASE_READ, blob.second.front());
+            read = reader.read(blob.first.first, contents);
+        }
+        if (!read) {
+            cerr << "Error: Cannot read blob " << blob.first.first << " of " << blob.second.front() << endl;
+            batch.fail();
+            continue;
+        }
+        batch.check_contents(blob.second, contents, blob.first.second, 0);
+    }
+    int status = batch.finish(outputFile);
+    cout << "Checked " << batch.file_count() << " changed files (" << blobs.size() << " distinct blobs) in "
+        << range << ". Results saved to " << outputFile << endl;
+    return status;
+}
+
+
+/**
+ * @brief Checks every version of the files in a git history and reports when each result changed.
+ *
+ * Commits are walked along first parents, oldest first. Each distinct blob
+ * is checked once, on the worker threads, each with its own
+ * `git cat-file --batch` process; a file that keeps or returns to earlier
+ * contents reuses the earlier result. The result file has one section per
+ * path whose errors changed at any commit of the range, with the first such
+ * commit and the errors after it; a file that is later fixed or reverted is
+ * still reported, even if it ends with the errors it started with. A
+ * missing file counts as having no errors.
  *
- * @param filename The name of the file to check.
- * @return true if the file ends with ".cpp", false otherwise.
+ * @param repository [in] Directory inside the repository.
+ * @param range [in] Revision range as accepted by `git rev-list`.
+ * @param outputFile [in] Result file to write.
+ * @param options [in] Extensions, filters and number of threads.
+ * @param budget [in] Budget copied for each blob.
+ * @param instruments [in,out] Statistics of the run.
+ * @return Exit status: 0 if every blob was checked, 1 otherwise.
  */
-bool has_cpp_extension(const string& filename) {
-	size_t dotPos = filename.rfind('.');
-	return dotPos != string::npos && filename.substr(dotPos) == ".cpp";
+static int check_history(const string& repository, const string& range, const string& outputFile,
+    const WalkOptions& options, const CheckBudget& budget, Instruments& instruments) {
+    vector<GitChange> baseline;
+    vector<GitCommitChanges> commits;
+    string error;
+    if (!list_history(repository, range, baseline, commits, error)) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+
+    // Each version of a checked file becomes an index into the distinct blobs; a removed file is npos
+    const size_t none = SIZE_MAX;
+    vector<pair<string, SourceLanguage>> blobs;
+    vector<string> blobPaths;  ///< A path of each blob, for messages
+    map<pair<string, SourceLanguage>, size_t> blobIndexes;
+    uint64_t versions = 0;
+    auto blob_index = [&](const GitChange& change, size_t& index) {
+        if (!has_source_extension(change.path, options.extensions) || options.exclude.ignored_file(change.path)) {
+            return false;
+        }
+        index = none;
+        if (!change.blobId.empty()) {
+            SourceLanguage language = LANGUAGE_CPP;
+            language_from_extension(change.path, language);
+            auto inserted = blobIndexes.emplace(make_pair(change.blobId, language), blobs.size());
+            if (inserted.second) {
+                blobs.emplace_back(change.blobId, language);
+                blobPaths.push_back(change.path);
+            }
+            index = inserted.first->second;
+            versions++;
+        }
+        return true;
+    };
+    vector<pair<string, size_t>> start;
+    for (const GitChange& change : baseline) {
+        size_t index;
+        if (blob_index(change, index)) {
+            start.emplace_back(change.path, index);
+        }
+    }
+    vector<vector<pair<string, size_t>>> steps(commits.size());
+    for (size_t i = 0; i < commits.size(); i++) {
+        for (const GitChange& change : commits[i].changes) {
+            size_t index;
+            if (blob_index(change, index)) {
+                steps[i].emplace_back(change.path, index);
+            }
+        }
+    }
+
+    unsigned workerCount = walk_thread_count(options);
+    BatchCheck batch(workerCount, budget, instruments);
+    vector<set<BracketError>> results(blobs.size());
+    vector<char> unread(blobs.size(), 0);
+    vector<unique_ptr<GitBlobReader>> readers(workerCount);
+    visit_indexes(blobs.size(), options, [&](size_t index, unsigned worker) {
+        thread_local string contents;
+        unique_ptr<GitBlobReader>& reader = readers[worker];
+        if (!reader) {
+            reader = make_unique<GitBlobReader>(repository);
+        }
+        bool read;
+        {
+            PhaseScope phase(batch.worker_instruments(worker), PHASE_READ, blobPaths[index]);
+            read = reader->running() && reader->read(blobs[index].first, contents);
+        }
+        if (!read) {
+            unread[index] = 1;
+            return;
+        }
+        results[index] = batch.check_buffer(blobPaths[index], contents, blobs[index].second, worker);
+    });
+    readers.clear();
+    for (size_t i = 0; i < blobs.size(); i++) {
+        if (unread[i]) {
+            cerr << "Error: Cannot read blob " << blobs[i].first << " of " << blobPaths[i] << endl;
+            batch.fail();
+        }
+    }
+    batch.merge_statistics();
+
+    // Replays the history, remembering for each path the first commit that changed its errors
+    struct PathHistory {
+        size_t first = none;      ///< Blob at the start of the range
+        size_t current = none;    ///< Blob after the last commit so far
+        size_t changedAt = none;  ///< Commit that first changed the errors
+        size_t changedTo = none;  ///< Blob after that commit
+    };
+    static const set<BracketError> noErrors;
+    auto errors_of = [&](size_t index) -> const set<BracketError>& {
+        return index == none ? noErrors : results[index];
+    };
+    // BracketError is only ordered, so equal sets are those where neither is less
+    auto same_errors = [&](size_t a, size_t b) {
+        return !(errors_of(a) < errors_of(b)) && !(errors_of(b) < errors_of(a));
+    };
+    map<string, PathHistory> paths;
+    for (const auto& entry : start) {
+        PathHistory& history = paths[entry.first];
+        history.first = history.current = entry.second;
+    }
+    for (size_t i = 0; i < steps.size(); i++) {
+        for (const auto& entry : steps[i]) {
+            PathHistory& history = paths[entry.first];
+            if (history.changedAt == none && !same_errors(history.current, entry.second)) {
+                history.changedAt = i;
+                history.changedTo = entry.second;
+            }
+            history.current = entry.second;
+        }
+    }
+
+    size_t changedFiles = 0;
+    {
+        PhaseScope phase(instruments, PHASE_PRINT, outputFile);
+        ofstream out(outputFile);
+        if (!out) {
+            cerr << "Error: Cannot open output file " << outputFile << endl;
+            return 1;
+        }
+        for (const auto& entry : paths) {
+            const PathHistory& history = entry.second;
+            if (history.changedAt == none) {
+                continue;
+            }
+            const set<BracketError>& after = errors_of(history.changedTo);
+            out << "File: " << entry.first << endl;
+            out << "First changed in " << commits[history.changedAt].commit << ": "
+                << errors_of(history.first).size() << " -> " << after.size() << " errors" << endl;
+            write_result(out, after);
+            out << endl;
+            changedFiles++;
+        }
+    }
+    cout << "Scanned " << commits.size() << " commits: " << blobs.size() << " distinct blobs for "
+        << versions << " file versions, " << changedFiles << " files changed their errors. Results saved to "
+        << outputFile << endl;
+    return batch.status();
 }
 
+
 /**
  * @brief Main entry point of the program.
  *
  * Accepts input/output file names, performs validation and parsing,
- * and writes results to the specified output file.
+ * and writes results to the specified output file. If the input is a
+ * directory, every matching file below it is checked in parallel and the
+ * output file gets one section per file.
+ * Options after the file names:
+ * - `--timeout-ms N` stops the check of a file after N milliseconds.
+ * - `--max-bytes N` rejects inputs larger than N bytes.
+ * - `--max-depth N` stops the check when brackets nest deeper than N.
+ * - `--stats` or `--stats=json` prints per-phase timing and memory statistics to stderr.
+ * - `--profile-counters` prints hardware counters per input byte for each phase (Linux).
+ * - `--trace out.json` writes per-file and per-phase spans in Chrome trace-event format.
+ * - `--latency [N]` prints latency percentiles and the N (default 10) slowest and largest files.
+ * - `--ext .cpp,.h` sets the extensions checked in a directory (default .cpp, .cc, .h, .hpp, .inl).
+ * - `--jobs N` checks a directory on N threads (default: one per hardware thread).
+ * - `--exclude PATTERN` skips paths below the directory matching a .gitignore-style pattern; repeatable.
+ * - `--ignore-file FILE` adds the patterns of FILE, relative to the directory.
+ * - `--no-gitignore` does not read the .gitignore files of the walked directories.
+ * - `--compile-commands` treats the input as a compile_commands.json and checks its source files.
+ * - `--git-diff BASE..HEAD` treats the input as a git repository and checks the files changed
+ *   between the revisions, as they are in HEAD.
+ * - `--history RANGE` treats the input as a git repository and reports, for each file, the first
+ *   commit of RANGE that changed its errors.
+ * - `--shard I/N` checks only shard I of N of a directory or compilation database; the shards
+ *   together check every file once and take about the same time.
+ * - `--merge` treats the input as a comma-separated list of shard result files and merges them
+ *   into the output file a single run would write.
  *
  * @param argc [in] Number of command-line arguments.
  * @param argv [in] Array of command-line argument strings.
@@ -48,31 +798,172 @@ bool has_cpp_extension(const string& filename) {
  */
 int main(int argc, const char* argv[]) {
     if (argc < 3) {
-        cerr << "Usage: BracketChecker2 <input.cpp> <result.txt>" << endl;
+        cerr << "Usage: BracketChecker2 <input.cpp|directory> <result.txt> [--timeout-ms N] [--max-bytes N] [--max-depth N]"
+            " [--stats[=json]]"
+            " [--profile-counters] [--trace out.json] [--latency [N]] [--ext .cpp,.h] [--jobs N]"
+            " [--exclude PATTERN] [--ignore-file FILE] [--no-gitignore] [--compile-commands]"
+            " [--git-diff BASE..HEAD] [--history RANGE] [--shard I/N] [--merge]" << endl;
         return 1;
     }
 
     string inputFile = argv[1];
     string outputFile = argv[2];
 
-    if (!has_cpp_extension(inputFile)) {
-        cerr << "Error: Invalid file extension. Please provide a .cpp file." << endl;
-        return 1;
+    CheckBudget budget;
+    enum { STATS_OFF, STATS_TEXT, STATS_JSON } statsMode = STATS_OFF;
+    bool profileCounters = false;
+    string traceFile;
+    bool latencyReport = false;
+    size_t topCount = 10;
+    WalkOptions walkOptions;
+    bool compileCommands = false;
+    string gitRange;
+    string historyRange;
+    ShardSpec shard;
+    bool merge = false;
+    for (int i = 3; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--timeout-ms" && i + 1 < argc) {
+            budget.timeout = chrono::milliseconds(strtoll(argv[++i], nullptr, 10));
+        }
+        else if (option == "--max-bytes" && i + 1 < argc) {
+            budget.maxBytes = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else if (option == "--max-depth" && i + 1 < argc) {
+            budget.maxDepth = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else if (option == "--stats") {
+            statsMode = STATS_TEXT;
+        }
+        else if (option == "--stats=json") {
+            statsMode = STATS_JSON;
+        }
+        else if (option == "--profile-counters") {
+            profileCounters = true;
+        }
+        else if (option == "--trace" && i + 1 < argc) {
+            traceFile = argv[++i];
+        }
+        else if (option == "--latency") {
+            latencyReport = true;
+            if (i + 1 < argc && isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                topCount = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+            }
+        }
+        else if (option == "--ext" && i + 1 < argc) {
+            walkOptions.extensions = parse_extension_list(argv[++i]);
+        }
+        else if (option == "--jobs" && i + 1 < argc) {
+            walkOptions.threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (option == "--exclude" && i + 1 < argc) {
+            walkOptions.exclude.add_pattern(argv[++i]);
+        }
+        else if (option == "--ignore-file" && i + 1 < argc) {
+            if (!walkOptions.exclude.add_file(argv[++i])) {
+                cerr << "Error: Cannot open ignore file " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else if (option == "--no-gitignore") {
+            walkOptions.readIgnoreFiles = false;
+        }
+        else if (option == "--compile-commands") {
+            compileCommands = true;
+        }
+        else if (option == "--git-diff" && i + 1 < argc) {
+            gitRange = argv[++i];
+        }
+        else if (option == "--history" && i + 1 < argc) {
+            historyRange = argv[++i];
+        }
+        else if (option == "--shard" && i + 1 < argc) {
+            if (!parse_shard(argv[++i], shard)) {
+                cerr << "Error: Expected --shard I/N with 1 <= I <= N, got " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else if (option == "--merge") {
+            merge = true;
+        }
+        else {
+            cerr << "Error: Unknown option " << option << endl;
+            return 1;
+        }
     }
 
-    vector<string> lines = read_input_file(inputFile);
-    set<BracketError> validationErrors = code_validation(lines);
-
-    if (!validationErrors.empty()) {
-        print_result(outputFile, validationErrors);
-        cerr << "Validation failed. See result.txt for details." << endl;
+    if (merge) {
+        vector<string> shardFiles;
+        for (size_t pos = 0; pos <= inputFile.size();) {
+            size_t end = min(inputFile.find(',', pos), inputFile.size());
+            if (end > pos) {
+                shardFiles.push_back(inputFile.substr(pos, end - pos));
+            }
+            pos = end + 1;
+        }
+        size_t files = 0;
+        string error;
+        if (!merge_shard_results(shardFiles, outputFile, files, error)) {
+            cerr << "Error: " << error << endl;
+            return 1;
+        }
+        cout << "Merged " << files << " files from " << shardFiles.size() << " shard results. Results saved to "
+            << outputFile << endl;
+        return 0;
+    }
+    error_code typeError;
+    bool directory = filesystem::is_directory(inputFile, typeError);
+    bool batch = directory || compileCommands || !gitRange.empty() || !historyRange.empty();
+    if (shard.count > 1 && (!batch || !gitRange.empty() || !historyRange.empty())) {
+        cerr << "Error: --shard applies to a directory or a compilation database." << endl;
         return 1;
     }
+    SourceLanguage language = LANGUAGE_CPP;
+    if (!batch && !language_from_extension(inputFile, language)) {
+        cerr << "Error: Invalid file extension. Please provide a .cpp, .json, .js, .py or .xml file." << endl;
+        return 1;
+    }
+
+    // Every phase is timed; the statistics are only printed with --stats
+    Instruments instruments;
+    instruments.topFiles = TopFiles(topCount);
+    unique_ptr<PerfCounterGroup> counterGroup;
+    if (profileCounters && batch) {
+        cerr << "Hardware counters are only collected for single files." << endl;
+    }
+    else if (profileCounters) {
+        counterGroup = make_unique<PerfCounterGroup>();
+        if (counterGroup->available()) {
+            instruments.counters = counterGroup.get();
+        }
+        else {
+            cerr << "Hardware counters unavailable: " << counterGroup->unavailable_reason() << endl;
+        }
+    }
+    if (!traceFile.empty()) {
+        start_tracing();
+    }
 
-    set<BracketError> parseErrors = parse_brackets(lines);
-    print_result(outputFile, parseErrors);
+    auto runStart = chrono::steady_clock::now();
+    int status = !historyRange.empty() ? check_history(inputFile, historyRange, outputFile, walkOptions, budget, instruments)
+        : !gitRange.empty() ? check_git_diff(inputFile, gitRange, outputFile, walkOptions, budget, instruments)
+        : compileCommands ? check_compile_commands(inputFile, outputFile, walkOptions, shard, budget, instruments)
+        : directory ? check_directory(inputFile, outputFile, walkOptions, shard, budget, instruments)
+        : check_input_file(inputFile, outputFile, language, budget, instruments);
+    instruments.stats.runWallSeconds = chrono::duration<double>(chrono::steady_clock::now() - runStart).count();
 
-    cout << "Bracket checking complete. Results saved to " << outputFile << endl;
-    return 0;
+    if (statsMode != STATS_OFF) {
+        instruments.stats.peakRssBytes = peak_rss_bytes();
+        print_stats(cerr, instruments.stats, statsMode == STATS_JSON);
+    }
+    if (instruments.counters) {
+        print_counters(cerr, instruments.phaseCounters, instruments.stats.bytes);
+    }
+    if (latencyReport) {
+        print_latency_report(cerr, instruments.latency, instruments.topFiles);
+    }
+    if (!traceFile.empty() && !write_trace(traceFile)) {
+        cerr << "Error: Cannot write trace file " << traceFile << endl;
+    }
+    return status;
 }
-
@@ -0,0 +1,418 @@
+/**
+ * @file PathFilter.cpp
+ * @brief Implementation of the compiled .gitignore-style rules.
+ */
+#include "PathFilter.h"
+
+
+GlobPattern::GlobPattern(string_view pattern) {
+    size_t i = 0;
+    while (i < pattern.size()) {
+        char ch = pattern[i];
+        State state{ STATE_CHAR };
+        if (ch == '\\' && i + 1 < pattern.size()) {
+            state.ch = pattern[i + 1];
+            states.push_back(state);
+            i += 2;
+        }
+        else if (ch == '*' && i + 1 < pattern.size() && pattern[i + 1] == '*') {
+            bool atComponentStart = i == 0 || pattern[i - 1] == '/';
+            bool atEnd = i + 2 == pattern.size();
+            if (atComponentStart && !atEnd && pattern[i + 2] == '/') {
+                // "**/" matches zero or more whole directories
+                states.push_back({ STATE_DIRS });
+                states.push_back({ STATE_DIRS_NAME });
+                i += 3;
+                continue;
+            }
+            if (atComponentStart && atEnd) {
+                // A trailing "/**" matches everything inside, not the directory itself
+                if (i != 0) {
+                    states.push_back({ STATE_ANY, '\0', true });
+                }
+                states.push_back({ STATE_STAR, '\0', true });
+            }
+            else {
+                states.push_back({ STATE_STAR });
+            }
+            i += 2;
+        }
+        else if (ch == '*') {
+            states.push_back({ STATE_STAR });
+            i++;
+        }
+        else if (ch == '?') {
+            states.push_back({ STATE_ANY });
+            i++;
+        }
+        else if (ch == '[') {
+            size_t j = i + 1;
+            state.kind = STATE_CLASS;
+            if (j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^')) {
+                state.negated = true;
+                j++;
+            }
+            vector<pair<unsigned char, unsigned char>> ranges;
+            size_t first = j;
+            while (j < pattern.size() && (pattern[j] != ']' || j == first)) {
+                if (pattern[j] == '\\' && j + 1 < pattern.size()) {
+                    j++;
+                }
+                unsigned char low = static_cast<unsigned char>(pattern[j]);
+                unsigned char high = low;
+                if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+                    high = static_cast<unsigned char>(pattern[j + 2]);
+                    j += 2;
+                }
+                ranges.push_back({ low, high });
+                j++;
+            }
+            if (j >= pattern.size()) {
+                // No closing bracket: the '[' is an ordinary character
+                state = { STATE_CHAR, '[' };
+                states.push_back(state);
+                i++;
+                continue;
+            }
+            state.classIndex = classes.size();
+            classes.push_back(move(ranges));
+            states.push_back(state);
+            i = j + 1;
+        }
+        else {
+            state.ch = ch;
+            states.push_back(state);
+            i++;
+        }
+    }
+}
+
+// Activates a state and the states reachable from it without input
+void GlobPattern::add_closure(vector<uint8_t>& active, size_t state) const {
+    if (active[state]) {
+        return;
+    }
+    active[state] = 1;
+    if (state == states.size()) {
+        return;
+    }
+    if (states[state].kind == STATE_STAR) {
+        add_closure(active, state + 1);
+    }
+    else if (states[state].kind == STATE_DIRS) {
+        add_closure(active, state + 2);
+    }
+}
+
+bool GlobPattern::matches(string_view text) const {
+    // Reused per thread, so matching does not allocate once warmed up
+    thread_local vector<uint8_t> current;
+    thread_local vector<uint8_t> next;
+    size_t accept = states.size();
+    current.assign(accept + 1, 0);
+    add_closure(current, 0);
+
+    for (char ch : text) {
+        next.assign(accept + 1, 0);
+        bool alive = false;
+        for (size_t s = 0; s < accept; s++) {
+            if (!current[s]) {
+                continue;
+            }
+            const State& state = states[s];
+            switch (state.kind) {
+            case STATE_CHAR:
+                if (ch == state.ch) {
+                    add_closure(next, s + 1);
+                }
+                break;
+            case STATE_ANY:
+                if (state.crossesSlash || ch != '/') {
+                    add_closure(next, s + 1);
+                }
+                break;
+            case STATE_CLASS:
+                if (ch != '/') {
+                    unsigned char c = static_cast<unsigned char>(ch);
+                    bool inClass = false;
+                    for (const auto& range : classes[state.classIndex]) {
+                        inClass = inClass || (c >= range.first && c <= range.second);
+                    }
+                    if (inClass != state.negated) {
+                        add_closure(next, s + 1);
+                    }
+                }
+                break;
+            case STATE_STAR:
+                if (state.crossesSlash || ch != '/') {
+                    add_closure(next, s);
+                }
+                break;
+            case STATE_DIRS:
+                add_closure(next, ch == '/' ? s : s + 1);
+                break;
+            case STATE_DIRS_NAME:
+                add_closure(next, ch == '/' ? s - 1 : s);
+                break;
+            }
+        }
+        current.swap(next);
+        for (uint8_t live : current) {
+            alive = alive || live;
+        }
+        if (!alive) {
+            return false;
+        }
+    }
+    return current[accept] != 0;
+}
+
+
+namespace {
+    // True if the pattern has an unescaped wildcard
+    bool has_wildcard(string_view pattern) {
+        for (size_t i = 0; i < pattern.size(); i++) {
+            if (pattern[i] == '\\') {
+                i++;
+            }
+            else if (pattern[i] == '*' || pattern[i] == '?' || pattern[i] == '[') {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    string unescape(string_view pattern) {
+        string text;
+        for (size_t i = 0; i < pattern.size(); i++) {
+            if (pattern[i] == '\\' && i + 1 < pattern.size()) {
+                i++;
+            }
+            text += pattern[i];
+        }
+        return text;
+    }
+
+    vector<string_view> split_components(string_view path) {
+        vector<string_view> components;
+        size_t pos = 0;
+        while (pos < path.size()) {
+            size_t end = path.find('/', pos);
+            if (end == string_view::npos) {
+                end = path.size();
+            }
+            if (end > pos) {
+                components.push_back(path.substr(pos, end - pos));
+            }
+            pos = end + 1;
+        }
+        return components;
+    }
+}
+
+
+void PathFilter::add_pattern(const string& line, const string& base) {
+    string_view pattern = line;
+    if (!pattern.empty() && pattern.back() == '\r') {
+        pattern.remove_suffix(1);
+    }
+    // Trailing spaces are dropped unless escaped
+    while (!pattern.empty() && pattern.back() == ' ' &&
+        !(pattern.size() >= 2 && pattern[pattern.size() - 2] == '\\')) {
+        pattern.remove_suffix(1);
+    }
+    if (pattern.empty() || pattern[0] == '#') {
+        return;
+    }
+
+    Rule rule;
+    if (pattern[0] == '!') {
+        rule.negated = true;
+        pattern.remove_prefix(1);
+    }
+    else if (pattern[0] == '\\' && pattern.size() > 1 && (pattern[1] == '!' || pattern[1] == '#')) {
+        pattern.remove_prefix(1);
+    }
+    while (!pattern.empty() && pattern.back() == '/') {
+        rule.directoryOnly = true;
+        pattern.remove_suffix(1);
+    }
+    if (pattern.empty()) {
+        return;
+    }
+    rule.base = base;
+    if (!rule.base.empty() && rule.base.back() != '/') {
+        rule.base += '/';
+    }
+
+    size_t index = rules.size();
+    bool anchored = pattern.find('/') != string_view::npos;
+    if (!anchored) {
+        if (!has_wildcard(pattern)) {
+            nameRules[unescape(pattern)].push_back(index);
+        }
+        else if (pattern.size() > 1 && pattern[0] == '*' && pattern[1] != '*' && !has_wildcard(pattern.substr(1))) {
+            string suffix = unescape(pattern.substr(1));
+            suffixRules[suffix].push_back(index);
+            if (find(suffixLengths.begin(), suffixLengths.end(), suffix.size()) == suffixLengths.end()) {
+                suffixLengths.push_back(suffix.size());
+                sort(suffixLengths.begin(), suffixLengths.end());
+            }
+        }
+        else {
+            rule.hasGlob = true;
+            rule.glob = GlobPattern(pattern);
+            basenameGlobs.push_back(index);
+        }
+        rules.push_back(move(rule));
+        return;
+    }
+
+    // Anchored: the base directory and the literal leading components go into the trie
+    if (pattern[0] == '/') {
+        pattern.remove_prefix(1);
+    }
+    size_t node = 0;
+    auto descend = [this, &node](const string& component) {
+        auto found = trie[node].children.find(component);
+        if (found != trie[node].children.end()) {
+            node = found->second;
+            return;
+        }
+        trie[node].children.emplace(component, trie.size());
+        node = trie.size();
+        trie.emplace_back();
+    };
+    for (string_view component : split_components(rule.base)) {
+        descend(string(component));
+    }
+    while (!pattern.empty()) {
+        size_t end = pattern.find('/');
+        string_view component = pattern.substr(0, end);
+        if (has_wildcard(component)) {
+            break;
+        }
+        descend(unescape(component));
+        pattern.remove_prefix(end == string_view::npos ? pattern.size() : end + 1);
+    }
+    if (!pattern.empty()) {
+        rule.hasGlob = true;
+        rule.glob = GlobPattern(pattern);
+    }
+    trie[node].rules.push_back(index);
+    rules.push_back(move(rule));
+}
+
+bool PathFilter::add_file(const string& ignoreFile, const string& base) {
+    ifstream file(ignoreFile);
+    if (!file.is_open()) {
+        return false;
+    }
+    string line;
+    while (getline(file, line)) {
+        add_pattern(line, base);
+    }
+    return true;
+}
+
+bool PathFilter::ignored(string_view relativePath, bool directory) const {
+    // A child's rules come after its parent's, so its own match decides first
+    for (const PathFilter* filter = this; filter; filter = filter->parent.get()) {
+        size_t best;
+        if (filter->last_match(relativePath, directory, best)) {
+            return !filter->rules[best].negated;
+        }
+    }
+    return false;
+}
+
+bool PathFilter::ignored_file(string_view relativePath) const {
+    if (empty()) {
+        return false;
+    }
+    // Outermost directory first, as the walker would meet them
+    for (size_t slash = relativePath.find('/'); slash != string_view::npos; slash = relativePath.find('/', slash + 1)) {
+        if (slash > 0 && ignored(relativePath.substr(0, slash), true)) {
+            return true;
+        }
+    }
+    return ignored(relativePath, false);
+}
+
+bool PathFilter::last_match(string_view relativePath, bool directory, size_t& best) const {
+    if (rules.empty()) {
+        return false;
+    }
+    vector<string_view> components = split_components(relativePath);
+    if (components.empty()) {
+        return false;
+    }
+    string_view name = components.back();
+
+    // The highest matching rule index wins, so candidates below the best are skipped
+    best = 0;
+    bool found = false;
+    auto offer = [&](size_t index, bool matches) {
+        if ((!found || index > best) && matches) {
+            best = index;
+            found = true;
+        }
+    };
+    auto applies = [&](const Rule& rule) {
+        return (!rule.directoryOnly || directory) &&
+            (rule.base.empty() || (relativePath.size() > rule.base.size() &&
+                relativePath.compare(0, rule.base.size(), rule.base) == 0));
+    };
+
+    auto byName = nameRules.find(string(name));
+    if (byName != nameRules.end()) {
+        for (size_t index : byName->second) {
+            offer(index, applies(rules[index]));
+        }
+    }
+    for (size_t length : suffixLengths) {
+        if (length > name.size()) {
+            break;
+        }
+        auto bySuffix = suffixRules.find(string(name.substr(name.size() - length)));
+        if (bySuffix != suffixRules.end()) {
+            for (size_t index : bySuffix->second) {
+                offer(index, applies(rules[index]));
+            }
+        }
+    }
+    for (size_t index : basenameGlobs) {
+        if (!found || index > best) {
+            offer(index, applies(rules[index]) && rules[index].glob.matches(name));
+        }
+    }
+
+    // Anchored rules: follow the path through the trie, trying the rules on the way
+    size_t node = 0;
+    for (size_t depth = 0; ; depth++) {
+        for (size_t index : trie[node].rules) {
+            if (found && index < best) {
+                continue;
+            }
+            const Rule& rule = rules[index];
+            bool matches = false;
+            if (!rule.hasGlob) {
+                matches = depth == components.size();
+            }
+            else if (depth < components.size()) {
+                size_t rest = static_cast<size_t>(components[depth].data() - relativePath.data());
+                matches = rule.glob.matches(relativePath.substr(rest));
+            }
+            offer(index, matches && (!rule.directoryOnly || directory));
+        }
+        if (depth == components.size()) {
+            break;
+        }
+        auto child = trie[node].children.find(string(components[depth]));
+        if (child == trie[node].children.end()) {
+            break;
+        }
+        node = child->second;
+    }
+    return found;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file PathFilter.h
+ * @brief Compiled .gitignore-style rules for excluding paths from tree scans.
+ *
+ * Rules use the .gitignore syntax: `#` comments, `!` negation, a trailing
+ * `/` for directories only, a leading or inner `/` to anchor the pattern at
+ * the directory of its ignore file, and the wildcards `*`, `?`, `[a-z]` and
+ * `**`. As in git, the last matching rule decides.
+ *
+ * Rules are sorted into indexes when they are added, so a lookup does not
+ * try every rule:
+ * - names without wildcards ("build") are looked up in a hash map,
+ * - names of the form "*.ext" are looked up by suffix,
+ * - anchored patterns are stored in a trie of their literal leading
+ *   components ("third_party/gen", or "out/debug" of "out/debug/lib?.a"),
+ *   and only the rules on the path through the trie are tried,
+ * - the remaining wildcards are compiled to a small automaton that matches
+ *   in one pass over the path, without backtracking.
+ */
+
+#pragma once
+#ifndef PATHFILTER_H
+#define PATHFILTER_H
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include "BracketChecker2.h"
+
+
+/**
+ * @class GlobPattern
+ * @brief One wildcard pattern compiled to a nondeterministic automaton.
+ *
+ * Matching keeps the set of live states, so it runs in O(text x pattern)
+ * time whatever the pattern, unlike a backtracking glob.
+ */
+class GlobPattern {
+public:
+    GlobPattern() = default;
+
+    /**
+     * @brief Compiles a pattern; `*`, `?` and classes do not match `/`, `**` does.
+     * @param pattern [in] Pattern in .gitignore syntax, without the leading `/` or `!`.
+     */
+    explicit GlobPattern(string_view pattern);
+
+    /**
+     * @brief True if the whole text matches.
+     */
+    bool matches(string_view text) const;
+
+private:
+    enum StateKind {
+        STATE_CHAR,         ///< One given character
+        STATE_ANY,          ///< One character; '/' only if crossesSlash
+        STATE_CLASS,        ///< One character of a [...] class, not '/'
+        STATE_STAR,         ///< Any run of characters; '/' only if crossesSlash
+        STATE_DIRS,         ///< Start of zero or more "name/" components (a leading "**/")
+        STATE_DIRS_NAME     ///< Inside one of those components
+    };
+
+    struct State {
+        StateKind kind;
+        char ch = '\0';
+        bool crossesSlash = false;
+        bool negated = false;
+        size_t classIndex = 0;
+    };
+
+    void add_closure(vector<uint8_t>& active, size_t state) const;
+
+    vector<State> states;
+    vector<vector<pair<unsigned char, unsigned char>>> classes;  ///< Ranges of each class
+};
+
+
+/**
+ * @class PathFilter
+ * @brief Decides whether a path below the scan root is ignored.
+ *
+ * Paths are relative to the scan root and use '/' as separator. A filter
+ * tests one path at a time; a directory that is ignored hides everything
+ * below it only because the walker never lists it.
+ *
+ * A filter may extend a parent, e.g. the rules of a nested .gitignore
+ * extending those of the directories above it. The parent is shared, not
+ * copied, and its rules come first: a rule of the child that matches
+ * decides, otherwise the parent does.
+ */
+class PathFilter {
+public:
+    PathFilter() = default;
+
+    /**
+     * @brief Creates an empty filter whose rules follow those of @p parent.
+     * @param parent [in] Rules tested when none of this filter's own rules match.
+     */
+    explicit PathFilter(shared_ptr<const PathFilter> parent) : parent(move(parent)) {
+    }
+
+    /**
+     * @brief Adds one line of an ignore file.
+     * @param pattern [in] Line in .gitignore syntax; blank lines and comments are skipped.
+     * @param base [in] Directory of the ignore file, relative to the root, "" for the root.
+     */
+    void add_pattern(const string& pattern, const string& base = "");
+
+    /**
+     * @brief Adds every line of an ignore file.
+     * @param ignoreFile [in] Path of the file.
+     * @param base [in] Directory the rules are relative to, "" for the root.
+     * @return False if the file cannot be opened.
+     */
+    bool add_file(const string& ignoreFile, const string& base = "");
+
+    /**
+     * @brief True if the last rule matching the path ignores it.
+     * @param relativePath [in] Path relative to the root, '/'-separated.
+     * @param directory [in] True if the path is a directory.
+     */
+    bool ignored(string_view relativePath, bool directory) const;
+
+    /**
+     * @brief True if a file or any directory above it is ignored.
+     *
+     * For file lists that are not walked, such as a compilation database,
+     * where no ignored directory is pruned before its files are seen.
+     * @param relativePath [in] Path of a file relative to the root, '/'-separated.
+     */
+    bool ignored_file(string_view relativePath) const;
+
+    /**
+     * @brief True if no rule has been added, here or in a parent.
+     */
+    bool empty() const { return rules.empty() && (!parent || parent->empty()); }
+
+private:
+    struct Rule {
+        string base;           ///< Ignore file directory with a trailing '/', or ""
+        bool negated = false;
+        bool directoryOnly = false;
+        bool hasGlob = false;  ///< False if the indexed literal part is the whole pattern
+        GlobPattern glob;      ///< Basename pattern, or the part after the literal components
+    };
+
+    struct TrieNode {
+        unordered_map<string, size_t> children;  ///< Component to node index
+        vector<size_t> rules;                    ///< Anchored rules whose literal part ends here
+    };
+
+    vector<Rule> rules;
+    unordered_map<string, vector<size_t>> nameRules;    ///< Literal basenames
+    unordered_map<string, vector<size_t>> suffixRules;  ///< "*suffix" basenames by suffix
+    vector<size_t> suffixLengths;                       ///< Distinct suffix lengths, ascending
+    vector<size_t> basenameGlobs;                       ///< Other unanchored patterns
+    vector<TrieNode> trie = vector<TrieNode>(1);        ///< Anchored patterns; node 0 is the root
+    shared_ptr<const PathFilter> parent;                ///< Rules before this filter's own, or null
+
+    /**
+     * @brief Index of the last own rule that matches the path.
+     * @return False if none of this filter's own rules match.
+     */
+    bool last_match(string_view relativePath, bool directory, size_t& best) const;
+};
+
+
+#endif // PATHFILTER_H
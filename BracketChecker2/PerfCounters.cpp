@@ -0,0 +1,161 @@
+/**
+ * @file PerfCounters.cpp
+ * @brief Implementation of the hardware counters; Linux only, stubs elsewhere.
+ */
+#include "PerfCounters.h"
+
+#include <iomanip>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+static const char* const counterNames[COUNTER_COUNT] = { "instructions", "cycles", "branch-misses", "cache-misses" };
+
+
+#ifdef __linux__
+
+// Opens one hardware event for the calling thread, counting user space only
+static int open_event(uint64_t config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+PerfCounterGroup::PerfCounterGroup() {
+    static const uint64_t configs[COUNTER_COUNT] = {
+        PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+    };
+    int firstError = 0;
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        descriptors[i] = open_event(configs[i]);
+        if (descriptors[i] < 0 && firstError == 0) {
+            firstError = errno;
+        }
+    }
+    if (!available()) {
+        reason = string("perf_event_open failed: ") + strerror(firstError);
+        if (firstError == EACCES || firstError == EPERM) {
+            reason += " (check /proc/sys/kernel/perf_event_paranoid or container permissions)";
+        }
+        else if (firstError == ENOENT || firstError == EOPNOTSUPP) {
+            reason += " (no hardware counters exposed, e.g. in a virtual machine)";
+        }
+    }
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+    for (int fd : descriptors) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+void PerfCounterGroup::start() {
+    for (int fd : descriptors) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounterGroup::stop(CounterValues& values) {
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        if (descriptors[i] < 0) continue;
+        ioctl(descriptors[i], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count = 0;
+        if (read(descriptors[i], &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count))) {
+            values.counts[i] += count;
+            values.valid[i] = true;
+        }
+    }
+}
+
+#else
+
+PerfCounterGroup::PerfCounterGroup() : reason("hardware counters are only supported on Linux") {
+    for (int& fd : descriptors) {
+        fd = -1;
+    }
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+}
+
+void PerfCounterGroup::start() {
+}
+
+void PerfCounterGroup::stop(CounterValues&) {
+}
+
+#endif
+
+bool PerfCounterGroup::available() const {
+    for (int fd : descriptors) {
+        if (fd >= 0) return true;
+    }
+    return false;
+}
+
+
+// Writes count / divisor, or n/a when the event is missing
+static void print_ratio(ostream& out, const CounterValues& values, PerfCounter counter, double divisor) {
+    out << setw(16);
+    if (values.valid[counter] && divisor > 0) {
+        out << static_cast<double>(values.counts[counter]) / divisor;
+    }
+    else {
+        out << "n/a";
+    }
+}
+
+void print_counters(ostream& out, const CounterValues (&phases)[PHASE_COUNT], uint64_t bytes) {
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+    out << fixed << setprecision(3);
+
+    double perByte = static_cast<double>(bytes);
+    out << left << setw(10) << "Phase" << right << setw(16) << "instr/byte" << setw(16) << "cycles/byte"
+        << setw(16) << "br-miss/byte" << setw(16) << "cache-miss/KB" << setw(16) << "IPC" << endl;
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        const CounterValues& values = phases[i];
+        out << left << setw(10) << phase_name(static_cast<CheckPhase>(i)) << right;
+        print_ratio(out, values, COUNTER_INSTRUCTIONS, perByte);
+        print_ratio(out, values, COUNTER_CYCLES, perByte);
+        print_ratio(out, values, COUNTER_BRANCH_MISSES, perByte);
+        print_ratio(out, values, COUNTER_CACHE_MISSES, perByte / 1024);
+        print_ratio(out, values, COUNTER_INSTRUCTIONS,
+            values.valid[COUNTER_CYCLES] ? static_cast<double>(values.counts[COUNTER_CYCLES]) : 0);
+        out << endl;
+    }
+    out << "Raw counts:";
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        out << " " << phase_name(static_cast<CheckPhase>(i)) << "{";
+        for (size_t k = 0; k < COUNTER_COUNT; k++) {
+            out << (k ? " " : "") << counterNames[k] << "=";
+            if (phases[i].valid[k]) {
+                out << phases[i].counts[k];
+            }
+            else {
+                out << "n/a";
+            }
+        }
+        out << "}";
+    }
+    out << endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,120 @@
+/**
+ * @file PerfCounters.h
+ * @brief Hardware performance counters around the phases of a check.
+ *
+ * On Linux the counters are opened with perf_event_open() for the calling
+ * thread, user space only. Where they are not permitted (containers,
+ * perf_event_paranoid, other platforms) PerfCounterGroup reports why and
+ * every measurement is a no-op, so callers need no special cases.
+ */
+
+#pragma once
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <ostream>
+#include "CheckStats.h"
+
+
+/**
+ * @enum PerfCounter
+ * @brief Hardware events that are counted.
+ */
+enum PerfCounter {
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CYCLES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_CACHE_MISSES,
+    COUNTER_COUNT
+};
+
+
+/**
+ * @struct CounterValues
+ * @brief Event counts of one phase, summed over all measurements.
+ */
+struct CounterValues {
+    uint64_t counts[COUNTER_COUNT] = {};
+    bool valid[COUNTER_COUNT] = {};  ///< False for events the hardware or kernel did not provide
+};
+
+
+/**
+ * @class PerfCounterGroup
+ * @brief Set of hardware counters of the calling thread.
+ *
+ * Events are opened one by one, so a machine lacking one event still
+ * reports the others.
+ */
+class PerfCounterGroup {
+public:
+    PerfCounterGroup();
+    ~PerfCounterGroup();
+
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    /**
+     * @brief True if at least one event could be opened.
+     */
+    bool available() const;
+
+    /**
+     * @brief Why no event could be opened, empty if available().
+     */
+    const string& unavailable_reason() const { return reason; }
+
+    /**
+     * @brief Resets and starts all opened events.
+     */
+    void start();
+
+    /**
+     * @brief Stops all events and adds their counts.
+     * @param values [in,out] Counts of the measured phase.
+     */
+    void stop(CounterValues& values);
+
+private:
+    int descriptors[COUNTER_COUNT];
+    string reason;
+};
+
+
+/**
+ * @class CounterScope
+ * @brief Counts events during its lifetime; does nothing without a group.
+ */
+class CounterScope {
+public:
+    CounterScope(PerfCounterGroup* group, CounterValues& values) : group(group), values(values) {
+        if (group) group->start();
+    }
+
+    ~CounterScope() {
+        if (group) group->stop(values);
+    }
+
+    CounterScope(const CounterScope&) = delete;
+    CounterScope& operator=(const CounterScope&) = delete;
+
+private:
+    PerfCounterGroup* group;
+    CounterValues& values;
+};
+
+
+/**
+ * @brief Writes per-byte metrics of every phase.
+ *
+ * Reports instructions, cycles and branch misses per input byte, cache
+ * misses per kilobyte and instructions per cycle; missing events print as "n/a".
+ * @param out [in,out] Destination stream.
+ * @param phases [in] Counts of each CheckPhase.
+ * @param bytes [in] Input bytes the phases processed.
+ */
+void print_counters(ostream& out, const CounterValues (&phases)[PHASE_COUNT], uint64_t bytes);
+
+
+#endif // PERFCOUNTERS_H
@@ -0,0 +1,139 @@
+/**
+ * @file Shard.cpp
+ * @brief Implementation of shard assignment and result merging.
+ */
+#include "Shard.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <sstream>
+
+
+namespace {
+    // Bytes a file costs beyond its size, for opening it; keeps empty files from piling onto one shard
+    const uint64_t FILE_COST = 4096;
+
+    const char SECTION_START[] = "File: ";
+    const size_t SECTION_START_LENGTH = sizeof(SECTION_START) - 1;
+}
+
+
+bool parse_shard(const string& text, ShardSpec& shard) {
+    size_t slash = text.find('/');
+    if (slash == string::npos || slash == 0 || slash + 1 == text.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < text.size(); i++) {
+        if (i != slash && !isdigit(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+    }
+    unsigned long index = strtoul(text.c_str(), nullptr, 10);
+    unsigned long count = strtoul(text.c_str() + slash + 1, nullptr, 10);
+    if (index < 1 || index > count || count > 1000000) {
+        return false;
+    }
+    shard.index = static_cast<unsigned>(index);
+    shard.count = static_cast<unsigned>(count);
+    return true;
+}
+
+uint64_t shard_hash(const string& key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char ch : key) {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+vector<unsigned> assign_shards(const vector<ShardFile>& files, unsigned count) {
+    vector<unsigned> shards(files.size(), 1);
+    if (count <= 1) {
+        return shards;
+    }
+
+    // Largest first; equal sizes in hash order, with the key settling the rare collision
+    vector<uint64_t> hashes(files.size());
+    vector<size_t> order(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        hashes[i] = shard_hash(files[i].key);
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (files[a].bytes != files[b].bytes) {
+            return files[a].bytes > files[b].bytes;
+        }
+        if (hashes[a] != hashes[b]) {
+            return hashes[a] < hashes[b];
+        }
+        return files[a].key < files[b].key;
+    });
+
+    // Each file goes to the least loaded shard, the lowest numbered one on a tie
+    using Load = pair<uint64_t, unsigned>;
+    priority_queue<Load, vector<Load>, greater<Load>> loads;
+    for (unsigned shard = 1; shard <= count; shard++) {
+        loads.push({ 0, shard });
+    }
+    for (size_t file : order) {
+        Load lightest = loads.top();
+        loads.pop();
+        shards[file] = lightest.second;
+        lightest.first += files[file].bytes + FILE_COST;
+        loads.push(lightest);
+    }
+    return shards;
+}
+
+bool merge_shard_results(const vector<string>& inputs, const string& outputFile, size_t& files, string& error) {
+    files = 0;
+    vector<pair<string, string>> sections;  // Path and the full text of its section
+    for (const string& input : inputs) {
+        ifstream in(input);
+        if (!in.is_open()) {
+            error = "Cannot open shard result " + input;
+            return false;
+        }
+        stringstream buffer;
+        buffer << in.rdbuf();
+        string text = buffer.str();
+
+        // A section starts with "File: " at the start of the file or after a blank line
+        size_t pos = 0;
+        while (pos < text.size()) {
+            if (text.compare(pos, SECTION_START_LENGTH, SECTION_START) != 0) {
+                error = input + " is not a batch result file";
+                return false;
+            }
+            size_t end = text.find(string("\n\n") + SECTION_START, pos);
+            end = end == string::npos ? text.size() : end + 2;
+            size_t pathEnd = text.find('\n', pos);
+            string path = text.substr(pos + SECTION_START_LENGTH, min(pathEnd, end) - pos - SECTION_START_LENGTH);
+            sections.emplace_back(move(path), text.substr(pos, end - pos));
+            pos = end;
+        }
+    }
+
+    sort(sections.begin(), sections.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (size_t i = 1; i < sections.size(); i++) {
+        if (sections[i].first == sections[i - 1].first) {
+            error = "File " + sections[i].first + " appears in more than one shard result";
+            return false;
+        }
+    }
+
+    ofstream out(outputFile);
+    if (!out) {
+        error = "Cannot open output file " + outputFile;
+        return false;
+    }
+    for (const auto& section : sections) {
+        out << section.second;
+    }
+    files = sections.size();
+    return true;
+}
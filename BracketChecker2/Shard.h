@@ -0,0 +1,82 @@
+/**
+ * @file Shard.h
+ * @brief Splitting a batch run into shards and merging their result files.
+ *
+ * Every shard lists the same files and computes the same assignment, so n
+ * processes given --shard 1/n .. n/n check each file exactly once without
+ * talking to each other. Files are assigned largest first to the shard with
+ * the fewest bytes so far, so the shards finish at about the same time;
+ * files of equal size are ordered by a hash of their path, which does not
+ * depend on the machine, the walk order or the number of threads. The
+ * per-shard result files are merged into the file a single run would write.
+ */
+
+#pragma once
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "BracketChecker2.h"
+
+
+/**
+ * @struct ShardSpec
+ * @brief One shard of a run, numbered from 1.
+ */
+struct ShardSpec {
+    unsigned index = 1;  ///< This shard, 1..count
+    unsigned count = 1;  ///< Number of shards; 1 checks everything
+};
+
+
+/**
+ * @struct ShardFile
+ * @brief A file to assign, with the key and weight the assignment uses.
+ */
+struct ShardFile {
+    string key;           ///< Path relative to the input, '/'-separated, the same on every machine
+    uint64_t bytes = 0;   ///< Size of the file
+};
+
+
+/**
+ * @brief Parses "i/n" with 1 <= i <= n.
+ * @return False if the text is not of that form.
+ */
+bool parse_shard(const string& text, ShardSpec& shard);
+
+
+/**
+ * @brief 64-bit FNV-1a hash of a path, the same on every platform.
+ */
+uint64_t shard_hash(const string& key);
+
+
+/**
+ * @brief Assigns each file to a shard, balancing the bytes of the shards.
+ *
+ * The result only depends on the keys, sizes and shard count, not on the
+ * order of @p files.
+ *
+ * @param files [in] Files of the whole run; keys are unique.
+ * @param count [in] Number of shards, at least 1.
+ * @return Shard of each file, 1..count, in the order of @p files.
+ */
+vector<unsigned> assign_shards(const vector<ShardFile>& files, unsigned count);
+
+
+/**
+ * @brief Merges result files of shards into one, ordered as a single run orders it.
+ *
+ * Each input consists of "File: path" sections as written by a batch run.
+ * The sections of all inputs are written sorted by path, unchanged.
+ *
+ * @param inputs [in] Result files of the shards.
+ * @param outputFile [in] Merged result file.
+ * @param files [out] Number of sections written.
+ * @param error [out] Why the results could not be merged.
+ * @return False if an input cannot be read or is not a batch result, or a path appears twice.
+ */
+bool merge_shard_results(const vector<string>& inputs, const string& outputFile, size_t& files, string& error);
+
+
+#endif // SHARD_H
@@ -0,0 +1,142 @@
+/**
+ * @file TraceLog.cpp
+ * @brief Per-thread trace buffers and the JSON writer.
+ */
+#include "TraceLog.h"
+
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+
+
+namespace {
+    /// One finished span.
+    struct TraceEvent {
+        const char* name;
+        double startMicros;
+        double durationMicros;
+        string file;
+        uint64_t bytes;
+        int64_t errors;
+    };
+
+    /// Events of one thread; only that thread appends to it.
+    struct ThreadBuffer {
+        int threadId;
+        vector<TraceEvent> events;
+    };
+
+    atomic<bool> tracingOn{ false };
+    chrono::steady_clock::time_point traceStart;
+
+    // The registry is only locked when a thread records its first event and when writing
+    mutex registryLock;
+    vector<unique_ptr<ThreadBuffer>> registry;
+
+    ThreadBuffer& this_thread_buffer() {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer) {
+            lock_guard<mutex> guard(registryLock);
+            registry.push_back(make_unique<ThreadBuffer>());
+            buffer = registry.back().get();
+            buffer->threadId = static_cast<int>(registry.size());
+            buffer->events.reserve(1024);
+        }
+        return *buffer;
+    }
+
+    double micros_since_start(chrono::steady_clock::time_point time) {
+        return chrono::duration<double, micro>(time - traceStart).count();
+    }
+
+    // Writes a JSON string literal
+    void write_json_string(ostream& out, const string& text) {
+        static const char hexDigits[] = "0123456789abcdef";
+        out << '"';
+        for (char ch : text) {
+            unsigned char byte = static_cast<unsigned char>(ch);
+            if (ch == '"' || ch == '\\') {
+                out << '\\' << ch;
+            }
+            else if (byte < 0x20) {
+                out << "\\u00" << hexDigits[byte >> 4] << hexDigits[byte & 0xF];
+            }
+            else {
+                out << ch;
+            }
+        }
+        out << '"';
+    }
+}
+
+
+void start_tracing() {
+    {
+        lock_guard<mutex> guard(registryLock);
+        for (const auto& buffer : registry) {
+            buffer->events.clear();
+        }
+    }
+    traceStart = chrono::steady_clock::now();
+    tracingOn.store(true, memory_order_release);
+}
+
+bool tracing_enabled() {
+    return tracingOn.load(memory_order_acquire);
+}
+
+bool write_trace(const string& path) {
+    tracingOn.store(false, memory_order_release);
+    ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << fixed << setprecision(3);
+
+    lock_guard<mutex> guard(registryLock);
+    out << "{\"traceEvents\": [\n";
+    bool first = true;
+    for (const auto& buffer : registry) {
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->threadId
+            << ", \"args\": {\"name\": \"thread " << buffer->threadId << "\"}}";
+        first = false;
+        for (const TraceEvent& event : buffer->events) {
+            out << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"check\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                << buffer->threadId << ", \"ts\": " << event.startMicros << ", \"dur\": " << event.durationMicros << ", \"args\": {";
+            const char* separator = "";
+            if (!event.file.empty()) {
+                out << "\"file\": ";
+                write_json_string(out, event.file);
+                separator = ", ";
+            }
+            if (event.bytes > 0) {
+                out << separator << "\"bytes\": " << event.bytes;
+                separator = ", ";
+            }
+            if (event.errors >= 0) {
+                out << separator << "\"errors\": " << event.errors;
+            }
+            out << "}}";
+        }
+    }
+    out << "\n], \"displayTimeUnit\": \"ms\"}" << endl;
+    return static_cast<bool>(out);
+}
+
+
+TraceSpan::TraceSpan(const char* name, const string* file)
+    : name(name), file(file), active(tracing_enabled()) {
+    if (active) {
+        start = chrono::steady_clock::now();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (!active) {
+        return;
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    ThreadBuffer& buffer = this_thread_buffer();
+    buffer.events.push_back({ name, micros_since_start(start), chrono::duration<double, micro>(end - start).count(),
+        file ? *file : string(), bytes, errors });
+}
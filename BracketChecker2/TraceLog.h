@@ -0,0 +1,77 @@
+/**
+ * @file TraceLog.h
+ * @brief Chrome/Perfetto trace-event export of checks.
+ *
+ * TraceSpan records one complete event ("ph": "X") per file and per phase,
+ * with the thread, the file name, its size and its error count. Every thread
+ * appends to its own buffer without locking; write_trace() writes all
+ * buffers as a JSON array that chrome://tracing and ui.perfetto.dev open.
+ * While tracing is off a span costs one atomic load.
+ */
+
+#pragma once
+#ifndef TRACELOG_H
+#define TRACELOG_H
+
+#include <chrono>
+#include <cstdint>
+#include "BracketChecker2.h"
+
+
+/**
+ * @brief Starts a new trace; earlier events are dropped and the trace clock starts now.
+ */
+void start_tracing();
+
+
+/**
+ * @brief True between start_tracing() and write_trace().
+ */
+bool tracing_enabled();
+
+
+/**
+ * @brief Stops tracing and writes the events of all threads.
+ *
+ * Call it after the traced worker threads have finished; their buffers
+ * outlive them.
+ * @param path [in] Output JSON file.
+ * @return False if the file cannot be written.
+ */
+bool write_trace(const string& path);
+
+
+/**
+ * @class TraceSpan
+ * @brief Records the time between its construction and destruction.
+ */
+class TraceSpan {
+public:
+    /**
+     * @brief Opens a span.
+     * @param name [in] Event name, e.g. "parse"; must outlive the trace (a literal).
+     * @param file [in] Optional file the span belongs to.
+     */
+    explicit TraceSpan(const char* name, const string* file = nullptr);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    /// Records the size of the processed input.
+    void set_bytes(uint64_t count) { bytes = count; }
+
+    /// Records the number of errors found.
+    void set_errors(size_t count) { errors = static_cast<int64_t>(count); }
+
+private:
+    const char* name;
+    const string* file;
+    bool active;
+    chrono::steady_clock::time_point start;
+    uint64_t bytes = 0;
+    int64_t errors = -1;
+};
+
+
+#endif // TRACELOG_H
@@ -0,0 +1,334 @@
+/**
+ * @file bench.cpp
+ * @brief Microbenchmarks of the reader, validator, parser and writer.
+ *
+ * Every case generates a source with a given size, nesting depth and
+ * comment, string and error density (see CorpusGenerator.h), then times read_input_file,
+ * code_validation, parse_brackets and print_result separately. Each row is
+ * per byte of what its phase processes: the input for read and parse, the
+ * lines below MAX_PROGRAM_LINES for validate (it rejects longer inputs at
+ * once), and the result file for print, whose work follows the error
+ * count rather than the input size. Each phase is
+ * warmed up, calibrated so one sample takes at least 20 ms, and sampled
+ * repeatedly; the median sample is reported as ns/byte and MB/s together
+ * with the median absolute deviation, so a change can be judged by numbers
+ * that do not move between runs. Adversarial cases (backslash storms, deep
+ * nesting, an unterminated comment) follow the generated ones. The project
+ * defines BRACKETCHECKER_ALLOC_TRACKING, so every row also shows the heap
+ * allocations of one call (see AllocTracker.h).
+ *
+ * Usage: benchBracketChecker2 [--samples N] [--scale F] [--filter TEXT] [--seed S]
+ *        benchBracketChecker2 --generate DIR [--count N] [--seed S] [--scale F]
+ *
+ * The second form writes generated sources with `.expected.txt` result
+ * files in the format of print_result().
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../BracketChecker2/AllocTracker.h"
+#include "../BracketChecker2/BracketChecker2.h"
+#include "../BracketChecker2/CorpusGenerator.h"
+
+using namespace std;
+
+
+/**
+ * @struct BenchCase
+ * @brief Shape of one generated input.
+ */
+struct BenchCase {
+    const char* name;
+    size_t bytes;
+    int depth;               ///< Maximum nesting depth
+    double commentDensity;   ///< Share of lines that are comments
+    double stringDensity;    ///< Share of lines with string or char literals
+    double errorDensity;     ///< Share of lines with a wrong or missing bracket
+};
+
+
+static const BenchCase benchCases[] = {
+    { "small",    4 << 10,  8,   0.10, 0.10, 0.0 },
+    { "plain",    4 << 20,  8,   0.10, 0.10, 0.0 },
+    { "deep",     4 << 20,  256, 0.10, 0.10, 0.0 },
+    { "comments", 4 << 20,  8,   0.60, 0.10, 0.0 },
+    { "strings",  4 << 20,  8,   0.10, 0.60, 0.0 },
+    { "errors",   4 << 20,  8,   0.10, 0.10, 0.01 },
+};
+
+
+/**
+ * @brief Generator options of a case.
+ * @param shape [in] Size, depth and densities.
+ * @param scale [in] Factor applied to the size.
+ * @param seed [in] Generator seed.
+ */
+static CorpusOptions corpus_options(const BenchCase& shape, double scale, uint64_t seed) {
+    CorpusOptions options;
+    options.seed = seed;
+    options.bytes = max<size_t>(64, static_cast<size_t>(static_cast<double>(shape.bytes) * scale));
+    options.maxDepth = shape.depth;
+    options.commentDensity = shape.commentDensity;
+    options.stringDensity = shape.stringDensity;
+    options.errorDensity = shape.errorDensity;
+    return options;
+}
+
+
+/**
+ * @brief Writes generated sources and their expected results, cycling through the cases.
+ * @param directory [in] Output directory, created if missing.
+ * @param count [in] Number of sources.
+ * @param seed [in] Seed of the first source; the others use the following seeds.
+ * @param scale [in] Factor applied to the case sizes.
+ * @return Exit status.
+ */
+static int generate_corpus(const string& directory, size_t count, uint64_t seed, double scale) {
+    error_code error;
+    filesystem::create_directories(directory, error);
+    const size_t caseCount = sizeof(benchCases) / sizeof(benchCases[0]);
+    for (size_t i = 0; i < count; i++) {
+        const BenchCase& shape = benchCases[i % caseCount];
+        CorpusOptions options = corpus_options(shape, scale, seed + i);
+        options.crlf = i % 2 == 1;
+        GeneratedSource source = generate_source(options);
+
+        string base = (filesystem::path(directory) / (string(shape.name) + "_" + to_string(options.seed))).string();
+        ofstream out(base + ".cpp", ios::binary);
+        out << source.text;
+        if (!out || !print_result(base + ".expected.txt", source.expected)) {
+            cerr << "Error: Cannot write " << base << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @struct Measurement
+ * @brief Median time of one call and its spread.
+ */
+struct Measurement {
+    double medianNs;
+    double deviationNs;   ///< Median absolute deviation of the samples
+};
+
+
+/**
+ * @brief Times a callable: warm-up, calibration, then repeated samples.
+ * @param samples [in] Number of samples.
+ * @param body [in] Work of one call.
+ * @return Median and spread of the time of one call.
+ */
+template <class Body>
+static Measurement measure(int samples, Body body) {
+    using Clock = chrono::steady_clock;
+    const chrono::nanoseconds minSample = chrono::milliseconds(20);
+
+    body();
+    size_t iterations = 1;
+    for (;;) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            body();
+        }
+        if (Clock::now() - start >= minSample || iterations >= (size_t(1) << 24)) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    vector<double> times;
+    for (int s = 0; s < samples; s++) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            body();
+        }
+        times.push_back(chrono::duration<double, nano>(Clock::now() - start).count() / static_cast<double>(iterations));
+    }
+    sort(times.begin(), times.end());
+    double median = times[times.size() / 2];
+    vector<double> deviations;
+    for (double time : times) {
+        deviations.push_back(time > median ? time - median : median - time);
+    }
+    sort(deviations.begin(), deviations.end());
+    return { median, deviations[deviations.size() / 2] };
+}
+
+
+/**
+ * @brief Counts the allocations of one call.
+ */
+template <class Body>
+static AllocCounts count_allocations(Body body) {
+    AllocCounts counts;
+    AllocScope scope(counts);
+    body();
+    return counts;
+}
+
+
+static void report(const char* caseName, const char* phase, size_t bytes, const Measurement& m, const AllocCounts& allocations) {
+    double nsPerByte = m.medianNs / static_cast<double>(bytes);
+    cout << left << setw(10) << caseName << setw(10) << phase << right
+        << setw(10) << bytes
+        << setw(12) << fixed << setprecision(3) << nsPerByte
+        << setw(14) << setprecision(1) << 1e3 / nsPerByte
+        << setw(9) << setprecision(1) << 100.0 * m.deviationNs / m.medianNs << "%"
+        << setw(10) << allocations.count << setw(12) << allocations.bytes << endl;
+}
+
+
+/**
+ * @struct AdversarialCase
+ * @brief Hand-built worst case for one part of the scanner.
+ */
+struct AdversarialCase {
+    const char* name;
+    string (*make)(size_t bytes);
+};
+
+
+static const AdversarialCase adversarialCases[] = {
+    // Quotes behind long odd runs of backslashes: the escape check must stay linear
+    { "storm", [](size_t bytes) {
+        string text;
+        while (text.size() < bytes) {
+            text += "\"" + string(985, '\\') + "\"\"\n";
+        }
+        return text;
+    } },
+    // Half a file of opening brackets, then the closing ones: the deepest possible stack
+    { "nesting", [](size_t bytes) {
+        string text;
+        for (char bracket : { '(', ')' }) {
+            for (size_t half = 0; half < bytes / 2; half += 500) {
+                text += string(500, bracket) + "\n";
+            }
+        }
+        return text;
+    } },
+    // An unterminated block comment full of comment closer candidates
+    { "comment", [](size_t bytes) {
+        string text = "/*\n";
+        while (text.size() < bytes) {
+            text += string(500, '*') + "\n";
+        }
+        return text;
+    } },
+};
+
+
+static const char* const benchInputFile = "bench_input.cpp";
+static const char* const benchOutputFile = "bench_result.txt";
+
+
+/**
+ * @brief Times every phase on one source.
+ * @param name [in] Case name for the report.
+ * @param source [in] Source text.
+ * @param samples [in] Number of samples per phase.
+ */
+static void run_phases(const char* name, const string& source, int samples) {
+    {
+        ofstream out(benchInputFile, ios::binary);
+        out << source;
+    }
+
+    vector<string> lines = read_input_file(benchInputFile);
+    size_t bytes = source.size();
+    set<BracketError> errors = parse_brackets(lines, LANGUAGE_CPP);
+    volatile size_t sink = 0;
+
+    // Longer inputs stop validation at the line count, so only a prefix within the limit is timed
+    vector<string> validated(lines.begin(), lines.begin() + min(lines.size(), MAX_PROGRAM_LINES - 1));
+    size_t validatedBytes = 0;
+    for (const string& line : validated) {
+        validatedBytes += line.size() + 1;
+    }
+
+    auto read = [&] { sink = read_input_file(benchInputFile).size(); };
+    auto validate = [&] { sink = code_validation(validated).size(); };
+    auto parse = [&] { sink = parse_brackets(lines, LANGUAGE_CPP).size(); };
+    auto print = [&] { sink = print_result(benchOutputFile, errors); };
+    report(name, "read", bytes, measure(samples, read), count_allocations(read));
+    report(name, "validate", validatedBytes, measure(samples, validate), count_allocations(validate));
+    report(name, "parse", bytes, measure(samples, parse), count_allocations(parse));
+    // Printing depends on the errors only, so its rate is that of the result file written
+    Measurement printTime = measure(samples, print);
+    error_code sizeError;
+    size_t printedBytes = static_cast<size_t>(filesystem::file_size(benchOutputFile, sizeError));
+    report(name, "print", max<size_t>(printedBytes, 1), printTime, count_allocations(print));
+    (void)sink;
+}
+
+
+/**
+ * @brief Runs every case whose name contains the filter.
+ */
+int main(int argc, const char* argv[]) {
+    int samples = 11;
+    double scale = 1.0;
+    string filter;
+    uint64_t seed = 1;
+    string corpusDirectory;
+    size_t count = 60;
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--samples" && i + 1 < argc) {
+            samples = max(1, atoi(argv[++i]));
+        }
+        else if (option == "--scale" && i + 1 < argc) {
+            scale = atof(argv[++i]);
+        }
+        else if (option == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        }
+        else if (option == "--seed" && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (option == "--generate" && i + 1 < argc) {
+            corpusDirectory = argv[++i];
+        }
+        else if (option == "--count" && i + 1 < argc) {
+            count = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else {
+            cerr << "Usage: benchBracketChecker2 [--samples N] [--scale F] [--filter TEXT] [--seed S]\n"
+                "       benchBracketChecker2 --generate DIR [--count N] [--seed S] [--scale F]" << endl;
+            return 1;
+        }
+    }
+    if (!corpusDirectory.empty()) {
+        return generate_corpus(corpusDirectory, count, seed, scale);
+    }
+
+    cout << left << setw(10) << "case" << setw(10) << "phase" << right << setw(10) << "bytes"
+        << setw(12) << "ns/byte" << setw(14) << "MB/s" << setw(10) << "+/-" << setw(10) << "allocs" << setw(12) << "alloc B" << endl;
+
+    for (const BenchCase& shape : benchCases) {
+        if (filter.empty() || string(shape.name).find(filter) != string::npos) {
+            run_phases(shape.name, generate_source(corpus_options(shape, scale, seed)).text, samples);
+        }
+    }
+    for (const AdversarialCase& adversarial : adversarialCases) {
+        if (filter.empty() || string(adversarial.name).find(filter) != string::npos) {
+            run_phases(adversarial.name, adversarial.make(max<size_t>(64, static_cast<size_t>(4e6 * scale))), samples);
+        }
+    }
+
+    remove(benchInputFile);
+    remove(benchOutputFile);
+    return 0;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file ReferenceChecker.h
+ * @brief Frozen copy of the original code_validation() and parse_brackets().
+ *
+ * This is the straightforward line-by-line implementation the checker
+ * started with. It is the oracle of the differential fuzzer: every faster
+ * engine must report exactly the same errors. Do not optimise or "fix" it;
+ * a behaviour change belongs in the engines and in this copy together, in
+ * one reviewed commit.
+ */
+
+#pragma once
+#ifndef REFERENCECHECKER_H
+#define REFERENCECHECKER_H
+
+#include "../BracketChecker2/BracketChecker2.h"
+
+
+namespace reference {
+
+// Validates code formatting: max number of lines, max line length, and no macro usage
+inline set<BracketError> code_validation(const vector<string>& lines) {
+    set<BracketError> errors;
+    // Check for too many lines
+    if (lines.size() >= 1000) {
+        errors.insert({ '\0', static_cast<int>(lines.size()), 1, TOO_LONG_PROGRAM });
+        return errors;
+    }
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        const string& line = lines[i];
+
+        // Check for long lines
+        if (line.length() >= 1000) {
+            errors.insert({ '\0', static_cast<int>(i + 1), 1001, TOO_LONG_LINE });
+        }
+        // Check for usage of #define macros
+        size_t pos = line.find("#define");
+        if (pos != string::npos) {
+            errors.insert({ '#', static_cast<int>(i + 1), static_cast<int>(pos + 1), MACRO_USAGE });
+        }
+    }
+
+    return errors;
+}
+
+// Helper: Returns true if character is an opening bracket
+inline bool isOpeningBracket(char ch) {
+    return ch == '(' || ch == '[' || ch == '{';
+}
+// Helper: Returns true if character is a closing bracket
+inline bool isClosingBracket(char ch) {
+    return ch == ')' || ch == ']' || ch == '}';
+}
+// Helper: Checks if the open and close brackets form a matching pair
+inline bool isMatchingPair(char open, char close) {
+    return (open == '(' && close == ')') ||
+        (open == '[' && close == ']') ||
+        (open == '{' && close == '}');
+}
+
+
+inline set<BracketError> parse_brackets(const vector<string>& lines) {
+    stack<pair<char, pair<int, int>>> bracketStack; // Stack stores (bracket, (line, column))
+    set<BracketError> errorPositions;
+    bool inBlockComment = false;
+
+    for (size_t lineNum = 0; lineNum < lines.size(); lineNum++) {
+        string line = lines[lineNum];
+        bool inLineComment = false;
+        bool inString = false;
+        char stringDelimiter = '\0';
+
+        for (size_t i = 0; i < line.size(); i++) {
+            char ch = line[i];
+            // Handle comments
+            if (i < line.size() - 1) {
+                if (!inBlockComment && line[i] == '/' && line[i + 1] == '/') {
+                    inLineComment = true; // Start of single-line comment
+                }
+                else if (!inLineComment && !inBlockComment && line[i] == '/' && line[i + 1] == '*') {
+                    inBlockComment = true; // Start of block comment
+                    i++; continue;
+                }
+                else if (inBlockComment && line[i] == '*' && line[i + 1] == '/') {
+                    inBlockComment = false; // End of block comment
+                    i++; continue;
+                }
+            }
+
+            if (inBlockComment || inLineComment) continue;
+
+            // Handle strings
+            // The original also compared ch with the multi-character constants of the curly
+            // quotes, which a single char never equals; they are left out so this builds warning-free
+            if (!inString && (ch == '"' || ch == '\'')) {
+                inString = true;
+                stringDelimiter = ch;
+                continue;
+            }
+            else if (inString) {
+                if (ch == stringDelimiter) {
+                    int backslashes = 0;
+                    size_t j = i;
+                    while (j > 0 && line[--j] == '\\') {
+                        backslashes++;
+                    }
+                    if (backslashes % 2 == 0) {
+                        inString = false;
+                    }
+                }
+                continue;
+            }
+
+            // Handle brackets
+            if (isOpeningBracket(ch)) {
+                bracketStack.push({ ch, {static_cast<int>(lineNum + 1), static_cast<int>(i + 1)} });
+            }
+            else if (isClosingBracket(ch)) {
+                if (!bracketStack.empty() && isMatchingPair(bracketStack.top().first, ch)) {
+                    bracketStack.pop();
+                }
+                else {  // Wrong closing bracket
+                    errorPositions.insert({ ch, static_cast<int>(lineNum + 1), static_cast<int>(i + 1), WRONG_BRACKET });
+                }
+            }
+        }
+    }
+    // Add remaining unmatched opening brackets
+    while (!bracketStack.empty()) {
+        auto top = bracketStack.top();
+        errorPositions.insert({ top.first, top.second.first, top.second.second, UNMATCHED_BRACKET });
+        bracketStack.pop();
+    }
+
+    return errorPositions;
+}
+
+} // namespace reference
+
+
+#endif // REFERENCECHECKER_H
@@ -0,0 +1,23 @@
+#!/bin/sh
+# Builds the differential fuzzer with clang and libFuzzer; no network access needed.
+#
+#   ./build.sh            libFuzzer build with ASan and UBSan -> fuzz_differential
+#   ./build.sh replay     plain build that replays files     -> fuzz_replay
+#
+# Run from this directory; new inputs go to corpus/, the fixtures of
+# BatchTest/tests are the read-only seed corpus:
+#
+#   mkdir -p corpus && ./fuzz_differential -max_len=8192 corpus ../BracketChecker2/BatchTest/tests
+#   ./fuzz_replay crash-<hash>
+set -e
+
+CXX=${CXX:-clang++}
+SRC=../BracketChecker2
+SOURCES="fuzz_differential.cpp $SRC/BracketChecker2.cpp $SRC/BracketCheckerEngine.cpp $SRC/BracketCheckerC.cpp"
+FLAGS="-std=c++20 -g -O1 -DBRACKETCHECKER_STATIC -I$SRC"
+
+if [ "$1" = "replay" ]; then
+    $CXX $FLAGS -DBRACKETCHECKER_FUZZ_REPLAY $SOURCES -o fuzz_replay
+else
+    $CXX $FLAGS -fsanitize=fuzzer,address,undefined $SOURCES -o fuzz_differential
+fi
@@ -0,0 +1,161 @@
+/**
+ * @file fuzz_differential.cpp
+ * @brief libFuzzer harness comparing every checking engine with the reference.
+ *
+ * Each input is decoded like read_input_file() does and split into lines.
+ * The errors of reference::code_validation() and reference::parse_brackets()
+ * are then compared with:
+ * - code_validation() and parse_brackets(), plain and with a budget,
+ * - the pmr overloads on the thread arena,
+ * - parse_brackets_as<CppLanguage>() and brackets_balanced(),
+ * - the BracketChecker engine and the C API on the raw bytes,
+ * - the constexpr bracket_check() on the decoded text.
+ * Any difference prints both error lists and aborts, so libFuzzer saves the
+ * input as a crash file.
+ *
+ * Built with BRACKETCHECKER_FUZZ_REPLAY (see build.sh) the harness gets its
+ * own main() that replays files, so crashes can be reproduced without clang.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+#include "ReferenceChecker.h"
+#include "../BracketChecker2/BracketCheckConstexpr.h"
+#include "../BracketChecker2/BracketCheckerC.h"
+#include "../BracketChecker2/BracketCheckerEngine.h"
+#include "../BracketChecker2/BracketLanguages.h"
+
+using namespace std;
+
+
+namespace {
+    // Splits like read_input_file(): '\n' ends a line and a '\r' before it is dropped
+    vector<string> split_lines(const string& text) {
+        vector<string> lines;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find('\n', pos);
+            size_t next = end + 1;
+            if (end == string::npos) {
+                end = text.size();
+                next = end;
+            }
+            else if (end > pos && text[end - 1] == '\r') {
+                end--;
+            }
+            lines.emplace_back(text, pos, end - pos);
+            pos = next;
+        }
+        return lines;
+    }
+
+    template <class Errors>
+    void print_errors(const char* title, const Errors& errors) {
+        cerr << title << ":" << endl;
+        for (const BracketError& error : errors) {
+            cerr << "  type " << error.type << " '" << error.bracket << "' at " << error.line << ":" << error.column << endl;
+        }
+    }
+
+    // Aborts with both error lists when an engine disagrees with the reference
+    template <class Expected, class Actual>
+    void expect_same(const char* engine, const Expected& expected, const Actual& actual) {
+        if (equal(expected.begin(), expected.end(), actual.begin(), actual.end(),
+            [](const BracketError& a, const BracketError& b) {
+                return a.bracket == b.bracket && a.line == b.line && a.column == b.column && a.type == b.type;
+            })) {
+            return;
+        }
+        cerr << "Mismatch in " << engine << endl;
+        print_errors("reference", expected);
+        print_errors(engine, actual);
+        abort();
+    }
+
+    void expect_true(const char* engine, bool condition) {
+        if (!condition) {
+            cerr << "Mismatch in " << engine << endl;
+            abort();
+        }
+    }
+}
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    string bytes(reinterpret_cast<const char*>(data), size);
+    string text = decode_input_text(bytes);
+    vector<string> lines = split_lines(text);
+
+    set<BracketError> validation = reference::code_validation(lines);
+    set<BracketError> parsed = reference::parse_brackets(lines);
+
+    // Library functions on the same lines
+    expect_same("code_validation", validation, code_validation(lines));
+    expect_same("parse_brackets", parsed, parse_brackets(lines));
+    expect_same("parse_brackets(LANGUAGE_CPP)", parsed, parse_brackets(lines, LANGUAGE_CPP));
+    expect_same("parse_brackets_as<CppLanguage>", parsed, parse_brackets_as<CppLanguage>(lines));
+    expect_true("brackets_balanced", brackets_balanced(lines, LANGUAGE_CPP) == parsed.empty());
+
+    CheckBudget budget;
+    budget.maxBytes = size + lines.size() + 1;
+    expect_same("parse_brackets with budget", parsed, parse_brackets(lines, LANGUAGE_CPP, &budget));
+    expect_true("budget", !budget.exceeded);
+
+    {
+        pmr::memory_resource* arena = thread_arena();
+        pmr::vector<pmr::string> arenaLines(arena);
+        for (const string& line : lines) {
+            arenaLines.emplace_back(line);
+        }
+        expect_same("code_validation(pmr)", validation, code_validation(arenaLines, arena));
+        expect_same("parse_brackets(pmr)", parsed, parse_brackets(arenaLines, LANGUAGE_CPP, arena));
+        expect_true("brackets_balanced(pmr)", brackets_balanced(arenaLines, LANGUAGE_CPP) == parsed.empty());
+    }
+    release_thread_arena();
+
+    // Whole pipeline on the raw bytes: validation errors, else bracket errors
+    const set<BracketError>& pipeline = validation.empty() ? parsed : validation;
+    static BracketChecker checker;
+    expect_same("BracketChecker", pipeline, checker.check(bytes));
+
+    static bc_checker* handle = bc_create(BC_LANGUAGE_CPP);
+    bc_check_buffer(handle, bytes.data(), bytes.size());
+    vector<BracketError> cErrors;
+    for (size_t i = 0; i < bc_error_count(handle); i++) {
+        const bc_error& error = bc_errors(handle)[i];
+        cErrors.push_back({ error.bracket, error.line, error.column, static_cast<BracketErrorType>(error.type) });
+    }
+    expect_same("C API", pipeline, cErrors);
+
+    // The constexpr checker only summarises, and stops at its stack capacity
+    BracketCheckResult summary = bracket_check(text);
+    if (!summary.depthExceeded) {
+        expect_true("bracket_check ok", summary.ok == parsed.empty());
+        expect_true("bracket_check errors", summary.errors == static_cast<int>(parsed.size()));
+        expect_true("bracket_check first error", parsed.empty() ||
+            (summary.line == parsed.begin()->line && summary.column == parsed.begin()->column));
+    }
+    return 0;
+}
+
+
+#ifdef BRACKETCHECKER_FUZZ_REPLAY
+#include <fstream>
+#include <iterator>
+
+/**
+ * @brief Replays the given files through the harness.
+ */
+int main(int argc, const char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        ifstream file(argv[i], ios::binary);
+        string contents((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+    }
+    cout << "Replayed " << argc - 1 << " inputs without differences." << endl;
+    return 0;
+}
+#endif
@@ -17,6 +17,29 @@
 #include <gtest/gtest.h>
 #include <set>
 #include "../BracketChecker2/BracketChecker2.h"  
+#include "../BracketChecker2/BracketCheckConstexpr.h"
+#include "../BracketChecker2/BracketCheckerEngine.h"
+#include "../BracketChecker2/BracketCheckerC.h"
+#include "../BracketChecker2/AsyncChecker.h"
+#include "../BracketChecker2/CheckStats.h"
+#include "../BracketChecker2/PerfCounters.h"
+#include "../BracketChecker2/TraceLog.h"
+#include "../BracketChecker2/LatencyReport.h"
+#include "../BracketChecker2/CorpusGenerator.h"
+#include "../BracketChecker2/AllocTracker.h"
+#include "../BracketChecker2/CompileCommands.h"
+#include "../BracketChecker2/DirectoryWalker.h"
+#include "../BracketChecker2/GitSource.h"
+#include "../BracketChecker2/PathFilter.h"
+#include "../BracketChecker2/Shard.h"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <thread>
 
 
 
@@ -65,6 +88,12 @@ void print_set_difference(const std::set<BracketError>& expected, const std::set
 using namespace std;
 
 
+/** @brief Number of calls to the global operator new since program start (AllocTracker.cpp counts them). */
+static size_t allocation_count() {
+    return static_cast<size_t>(alloc_totals().count);
+}
+
+
 
 /**
  * @test DetectUnmatchedOpeningParenthesis
@@ -482,6 +511,1383 @@ TEST(testBracketChecker2, DetectsMacroUsage) {
     print_set_difference(expected, errors);
 }
 
+/**
+ * @test ReadUtf16LittleEndianFile
+ * @brief Tests that a UTF-16LE file with BOM is transcoded before parsing.
+ */
+TEST(testBracketChecker2, ReadUtf16LittleEndianFile) {
+    string text = "int main() {\r\n    return 0;\r\n}\r\n";
+    string bytes = "\xFF\xFE";
+    for (char ch : text) {
+        bytes += ch;
+        bytes += '\0';
+    }
+    ofstream("test_utf16le.txt", ios::binary) << bytes;
+
+    vector<string> lines = read_input_file("test_utf16le.txt");
+    vector<string> expected = { "int main() {", "    return 0;", "}" };
+    EXPECT_EQ(lines, expected);
+    EXPECT_TRUE(parse_brackets(lines).empty());
+}
+
+/**
+ * @test DecodeUtf16BigEndian
+ * @brief Tests UTF-16BE decoding of ASCII, Cyrillic and a surrogate pair.
+ */
+TEST(testBracketChecker2, DecodeUtf16BigEndian) {
+    string bytes("\xFE\xFF\x00(\x04\x1F\xD8\x3D\xDE\x00\x00)", 12);
+    EXPECT_EQ(decode_input_text(bytes), "(\xD0\x9F\xF0\x9F\x98\x80)");
+}
+
+/**
+ * @test StripUtf8Bom
+ * @brief Tests that the UTF-8 BOM does not shift columns of the first line.
+ */
+TEST(testBracketChecker2, StripUtf8Bom) {
+    ofstream("test_utf8bom.txt", ios::binary) << "\xEF\xBB\xBF(";
+    vector<string> lines = read_input_file("test_utf8bom.txt");
+    set<BracketError> expected = {
+        {'(', 1, 1, UNMATCHED_BRACKET}
+    };
+    EXPECT_EQ(parse_brackets(lines), expected);
+}
+
+/**
+ * @test PythonCommentsAndTripleQuotedStrings
+ * @brief Tests '#' comments and triple-quoted strings spanning lines.
+ */
+TEST(testBracketChecker2, PythonCommentsAndTripleQuotedStrings) {
+    vector<string> code = {
+        "def f(x):  # closes ) here",
+        "    s = \"\"\"text ( [",
+        "    still { string\"\"\"",
+        "    return g(\"#\", s]"
+    };
+    set<BracketError> expected = {
+        {']', 4, 20, WRONG_BRACKET},
+        {'(', 4, 13, UNMATCHED_BRACKET}
+    };
+    auto actual = parse_brackets(code, LANGUAGE_PYTHON);
+    EXPECT_EQ(actual, expected);
+    print_set_difference(expected, actual);
+}
+
+/**
+ * @test JavaScriptTemplateLiteral
+ * @brief Tests backtick template literals spanning lines.
+ */
+TEST(testBracketChecker2, JavaScriptTemplateLiteral) {
+    vector<string> code = {
+        "const s = `line ( one",
+        "line } two`; f(s);"
+    };
+    EXPECT_TRUE(parse_brackets(code, LANGUAGE_JAVASCRIPT).empty());
+    EXPECT_FALSE(parse_brackets(code, LANGUAGE_CPP).empty());
+}
+
+/**
+ * @test JsonAndXmlBrackets
+ * @brief Tests the bracket alphabets of JSON and XML.
+ */
+TEST(testBracketChecker2, JsonAndXmlBrackets) {
+    vector<string> json = { "{\"a\": [1, \"]\"], \"b\": \"(\"}" };
+    EXPECT_TRUE(parse_brackets(json, LANGUAGE_JSON).empty());
+
+    vector<string> xml = { "<a x=\"1\">(<!-- < -->", "</a" };
+    set<BracketError> expected = {
+        {'<', 2, 1, UNMATCHED_BRACKET}
+    };
+    auto actual = parse_brackets(xml, LANGUAGE_XML);
+    EXPECT_EQ(actual, expected);
+    print_set_difference(expected, actual);
+}
+
+/**
+ * @test LanguageFromExtension
+ * @brief Tests selection of the language policy by file extension.
+ */
+TEST(testBracketChecker2, LanguageFromExtension) {
+    SourceLanguage language = LANGUAGE_CPP;
+    EXPECT_TRUE(language_from_extension("dir.v2/main.py", language));
+    EXPECT_EQ(language, LANGUAGE_PYTHON);
+    EXPECT_TRUE(language_from_extension("a.hpp", language));
+    EXPECT_EQ(language, LANGUAGE_CPP);
+    EXPECT_FALSE(language_from_extension("notes.txt", language));
+    EXPECT_FALSE(language_from_extension("Makefile", language));
+}
+
+static_assert(bracket_check(R"(int main() { return f("}", '{'); } // ])").ok, "balanced snippet");
+static_assert(bracket_check("{)").errors == 2, "wrong and unmatched bracket");
+static_assert(bracket_check("x\n ( /* ) */").column == 2, "first error position");
+
+/**
+ * @test ConstexprCheckMatchesParser
+ * @brief Tests that bracket_check() agrees with parse_brackets() at run time.
+ */
+TEST(testBracketChecker2, ConstexprCheckMatchesParser) {
+    vector<vector<string>> sources = {
+        { "int main() {", "    /* { */ if (a[0]) {", "        s = \"\\\"(\";", "}" },
+        { "({) }" },
+        { "Int main(", "{" },
+        { "" }
+    };
+    for (const auto& lines : sources) {
+        string text;
+        for (const auto& line : lines) {
+            text += line + "\n";
+        }
+        set<BracketError> errors = parse_brackets(lines);
+        BracketCheckResult result = bracket_check(text);
+        EXPECT_EQ(result.ok, errors.empty());
+        EXPECT_EQ(result.errors, static_cast<int>(errors.size()));
+        if (!errors.empty()) {
+            EXPECT_EQ(result.line, errors.begin()->line);
+            EXPECT_EQ(result.column, errors.begin()->column);
+        }
+    }
+    EXPECT_TRUE(bracket_check<4>("((((((").depthExceeded);
+}
+
+/**
+ * @test FastVerdictBalanced
+ * @brief Tests the fast balanced verdict on clean code and markers crossing 64-byte blocks.
+ */
+TEST(testBracketChecker2, FastVerdictBalanced) {
+    vector<string> code = {
+        "int main() {",
+        string(62, ' ') + "/* ) */ f(\"]\"); // }",
+        "}"
+    };
+    EXPECT_TRUE(brackets_balanced(code, LANGUAGE_CPP));
+    EXPECT_TRUE(parse_brackets(code).empty());
+}
+
+/**
+ * @test FastVerdictInterleavedBrackets
+ * @brief Tests that interleaved bracket types are not reported as balanced.
+ */
+TEST(testBracketChecker2, FastVerdictInterleavedBrackets) {
+    vector<string> code = { "([)]" };
+    EXPECT_FALSE(brackets_balanced(code, LANGUAGE_CPP));
+    EXPECT_FALSE(brackets_balanced(vector<string>{ "{" }, LANGUAGE_CPP));
+    EXPECT_FALSE(parse_brackets(code).empty());
+}
+
+/**
+ * @test BracketStructurePairsAndFolding
+ * @brief Tests the matching-pair table, folding ranges and maximum depth.
+ */
+TEST(testBracketChecker2, BracketStructurePairsAndFolding) {
+    vector<string> code = {
+        "int main() {",
+        "    if (a[0]) {",
+        "    }",
+        "}"
+    };
+    BracketStructure structure;
+    set<BracketError> errors = parse_brackets(code, LANGUAGE_CPP, structure);
+    EXPECT_TRUE(errors.empty());
+
+    vector<int> openLine = { 1, 2, 2, 2, 1 };
+    vector<int> openColumn = { 9, 10, 8, 15, 12 };
+    vector<int> closeLine = { 1, 2, 2, 3, 4 };
+    vector<int> depth = { 1, 3, 2, 2, 1 };
+    EXPECT_EQ(structure.openLine, openLine);
+    EXPECT_EQ(structure.openColumn, openColumn);
+    EXPECT_EQ(structure.closeLine, closeLine);
+    EXPECT_EQ(structure.depth, depth);
+    EXPECT_EQ(structure.maxDepth, 3);
+
+    ASSERT_EQ(structure.foldingRanges.size(), 2u);
+    EXPECT_EQ(structure.foldingRanges[0].startLine, 1);
+    EXPECT_EQ(structure.foldingRanges[0].endLine, 4);
+    EXPECT_EQ(structure.foldingRanges[1].startLine, 2);
+    EXPECT_EQ(structure.foldingRanges[1].endLine, 3);
+}
+
+/**
+ * @test EngineMatchesFreeFunctions
+ * @brief Tests that BracketChecker reports the same errors as the free-function pipeline.
+ */
+TEST(testBracketChecker2, EngineMatchesFreeFunctions) {
+    vector<string> sources = {
+        "int main() {\r\n    if (a[0]) {\r\n}\r\n",
+        "({) }",
+        "#define X (\n",
+        "s = \"{\"; /* ] */ f(x]",
+        ""
+    };
+    BracketChecker checker;
+    for (const auto& source : sources) {
+        vector<string> lines;
+        size_t pos = 0;
+        while (pos < source.size()) {
+            size_t end = source.find('\n', pos);
+            if (end == string::npos) end = source.size();
+            string line = source.substr(pos, end - pos);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            lines.push_back(line);
+            pos = end + 1;
+        }
+        set<BracketError> expected = code_validation(lines);
+        if (expected.empty()) {
+            expected = parse_brackets(lines);
+        }
+        const auto& actual = checker.check(source);
+        EXPECT_EQ(set<BracketError>(actual.begin(), actual.end()), expected) << source;
+        EXPECT_TRUE(is_sorted(actual.begin(), actual.end()));
+    }
+}
+
+/**
+ * @test EngineZeroAllocationsAfterWarmUp
+ * @brief Tests that repeated checks do not allocate once the buffers have grown.
+ */
+TEST(testBracketChecker2, EngineZeroAllocationsAfterWarmUp) {
+    string source;
+    for (int i = 0; i < 200; i++) {
+        source += "void f" + to_string(i) + "(int a[2]) { if (a[0]) { g(\"}\"); } } ( ]\n";
+    }
+    ofstream("test_engine.cpp", ios::binary) << source;
+
+    BracketChecker checker;
+    checker.check(source);
+    ASSERT_TRUE(checker.check_file("test_engine.cpp"));
+    size_t errorCount = checker.errors().size();
+
+    size_t before = allocation_count();
+    for (int i = 0; i < 10; i++) {
+        checker.check(source);
+        checker.check_file("test_engine.cpp");
+    }
+    EXPECT_EQ(allocation_count() - before, 0u);
+    EXPECT_EQ(checker.errors().size(), errorCount);
+    EXPECT_EQ(errorCount, 400u);
+}
+
+/**
+ * @test EngineReportsReadErrors
+ * @brief Tests that a file that opens but cannot be read, such as a directory, is not checked as empty.
+ */
+TEST(testBracketChecker2, EngineReportsReadErrors) {
+    BracketChecker checker;
+    checker.check("int main() { (");
+    EXPECT_FALSE(checker.check_file("."));
+    EXPECT_TRUE(checker.errors().empty());
+}
+
+/**
+ * @test PmrPipelineAllocatesFromResource
+ * @brief Tests that the allocator-aware pipeline gives the same errors without touching the global allocator.
+ */
+TEST(testBracketChecker2, PmrPipelineAllocatesFromResource) {
+    ofstream("test_pmr.cpp", ios::binary) << "int main() {\n    f(a[0]];\n    #define X\n";
+    vector<string> lines = read_input_file("test_pmr.cpp");
+
+    char buffer[16384];
+    pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), pmr::null_memory_resource());
+    pmr::vector<pmr::string> arenaLines = read_input_file("test_pmr.cpp", &arena);
+    ASSERT_EQ(arenaLines.size(), lines.size());
+
+    size_t before = allocation_count();
+    pmr::set<BracketError> validationErrors = code_validation(arenaLines, &arena);
+    pmr::set<BracketError> parseErrors = parse_brackets(arenaLines, LANGUAGE_CPP, &arena);
+    bool balanced = brackets_balanced(arenaLines, LANGUAGE_CPP);
+    EXPECT_EQ(allocation_count() - before, 0u);
+
+    set<BracketError> expectedValidation = code_validation(lines);
+    set<BracketError> expectedParse = parse_brackets(lines);
+    EXPECT_EQ(set<BracketError>(validationErrors.begin(), validationErrors.end()), expectedValidation);
+    EXPECT_EQ(set<BracketError>(parseErrors.begin(), parseErrors.end()), expectedParse);
+    EXPECT_EQ(balanced, expectedParse.empty());
+}
+
+/**
+ * @test ThreadArenaReleaseReusesBuffer
+ * @brief Tests that the per-thread arena serves repeated batches after release without malloc.
+ */
+TEST(testBracketChecker2, ThreadArenaReleaseReusesBuffer) {
+    {
+        pmr::vector<pmr::string> lines(thread_arena());
+        lines.assign(50, pmr::string("if (a[i]) { b(); } // some text that is long enough", thread_arena()));
+    }
+    release_thread_arena();
+
+    size_t before = allocation_count();
+    size_t errorCount = 0;
+    for (int i = 0; i < 5; i++) {
+        {
+            BracketChecker checker(LANGUAGE_CPP, thread_arena());
+            errorCount += checker.check("int main() { return (1]; }").size();
+        }
+        release_thread_arena();
+    }
+    EXPECT_EQ(allocation_count() - before, 0u);
+    EXPECT_EQ(errorCount, 5 * 4u);
+}
+
+/**
+ * @test CApiReportsErrors
+ * @brief Tests the C interface on a buffer, a missing file and invalid arguments.
+ */
+TEST(testBracketChecker2, CApiReportsErrors) {
+    EXPECT_EQ(bc_api_version(), BC_API_VERSION);
+    EXPECT_EQ(bc_create(42), nullptr);
+
+    bc_checker* checker = bc_create(BC_LANGUAGE_CPP);
+    ASSERT_NE(checker, nullptr);
+
+    const char source[] = "int main() {\n    return (1];\n";
+    ASSERT_EQ(bc_check_buffer(checker, source, sizeof(source) - 1), 3);
+    ASSERT_EQ(bc_error_count(checker), 3u);
+    const bc_error* errors = bc_errors(checker);
+    EXPECT_EQ(errors[0].type, BC_UNMATCHED_BRACKET);
+    EXPECT_EQ(errors[0].line, 1);
+    EXPECT_EQ(errors[0].column, 12);
+    EXPECT_EQ(errors[1].type, BC_UNMATCHED_BRACKET);
+    EXPECT_EQ(errors[2].type, BC_WRONG_BRACKET);
+    EXPECT_EQ(errors[2].bracket, ']');
+    EXPECT_STREQ(bc_error_description(errors[2].type), "Wrong closing bracket");
+
+    EXPECT_EQ(bc_set_language(checker, BC_LANGUAGE_PYTHON), 0);
+    EXPECT_EQ(bc_check_buffer(checker, "x = [1, 2]  # ]", 15), 0);
+    EXPECT_EQ(bc_errors(checker), nullptr);
+
+    EXPECT_EQ(bc_check_file(checker, "no_such_file.py"), -1);
+    EXPECT_EQ(bc_check_buffer(checker, nullptr, 1), -1);
+    EXPECT_EQ(bc_set_language(checker, -1), -1);
+    bc_destroy(checker);
+    bc_destroy(nullptr);
+}
+
+/// Fire-and-forget coroutine used to drive check_file_async() from a test.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        suspend_never initial_suspend() noexcept { return {}; }
+        suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+    };
+};
+
+static DetachedTask await_check(AsyncChecker& checker, string path, stop_token stop,
+    AsyncChecker::Clock::time_point deadline, promise<AsyncCheckResult>& done) {
+    done.set_value(co_await checker.check_file_async(move(path), stop, deadline));
+}
+
+/**
+ * @test AsyncCheckFile
+ * @brief Tests awaitable checks: many in flight, missing file, unreadable path, cancellation and deadline.
+ */
+TEST(testBracketChecker2, AsyncCheckFile) {
+    ofstream("test_async.cpp", ios::binary) << "int main() {\n    return (1];\n";
+    set<BracketError> expected = parse_brackets(read_input_file("test_async.cpp"));
+
+    AsyncChecker checker(LANGUAGE_CPP, 4, 2);
+    const AsyncChecker::Clock::time_point never = AsyncChecker::Clock::time_point::max();
+    vector<promise<AsyncCheckResult>> results(64);
+    for (auto& result : results) {
+        await_check(checker, "test_async.cpp", {}, never, result);
+    }
+    for (auto& result : results) {
+        AsyncCheckResult outcome = result.get_future().get();
+        EXPECT_EQ(outcome.status, CHECK_COMPLETED);
+        EXPECT_EQ(set<BracketError>(outcome.errors.begin(), outcome.errors.end()), expected);
+    }
+
+    promise<AsyncCheckResult> missing;
+    await_check(checker, "no_such_file.cpp", {}, never, missing);
+    EXPECT_EQ(missing.get_future().get().status, CHECK_CANNOT_OPEN);
+
+    // A directory opens as a stream on some platforms, but reading it fails
+    promise<AsyncCheckResult> unreadable;
+    await_check(checker, ".", {}, never, unreadable);
+    AsyncCheckResult failed = unreadable.get_future().get();
+    EXPECT_NE(failed.status, CHECK_COMPLETED);
+    EXPECT_TRUE(failed.errors.empty());
+
+    stop_source stop;
+    stop.request_stop();
+    promise<AsyncCheckResult> cancelled;
+    await_check(checker, "test_async.cpp", stop.get_token(), never, cancelled);
+    AsyncCheckResult outcome = cancelled.get_future().get();
+    EXPECT_EQ(outcome.status, CHECK_CANCELLED);
+    EXPECT_TRUE(outcome.errors.empty());
+
+    promise<AsyncCheckResult> late;
+    await_check(checker, "test_async.cpp", {}, AsyncChecker::Clock::now() - chrono::seconds(1), late);
+    EXPECT_EQ(late.get_future().get().status, CHECK_DEADLINE_EXCEEDED);
+}
+
+/**
+ * @test BudgetStopsLongChecks
+ * @brief Tests that byte, time and stop budgets end a check with a single BUDGET_EXCEEDED error.
+ */
+TEST(testBracketChecker2, BudgetStopsLongChecks) {
+    vector<string> lines(5000, "    values[i] = compute(a[i], { b, c }); // (unbalanced] in a comment");
+    lines.push_back("}");
+    set<BracketError> expected = parse_brackets(lines, LANGUAGE_CPP);
+
+    CheckBudget generous;
+    generous.deadline = chrono::steady_clock::now() + chrono::hours(1);
+    EXPECT_EQ(parse_brackets(lines, LANGUAGE_CPP, &generous), expected);
+    EXPECT_FALSE(generous.exceeded);
+
+    CheckBudget tooSmall;
+    tooSmall.maxBytes = 100000;
+    set<BracketError> errors = parse_brackets(lines, LANGUAGE_CPP, &tooSmall);
+    EXPECT_TRUE(tooSmall.exceeded);
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_EQ(errors.begin()->type, BUDGET_EXCEEDED);
+    EXPECT_GT(errors.begin()->line, 1);
+
+    CheckBudget expired;
+    expired.deadline = chrono::steady_clock::now();
+    EXPECT_FALSE(brackets_balanced(lines, LANGUAGE_CPP, &expired));
+    EXPECT_TRUE(expired.exceeded);
+
+    stop_source stop;
+    stop.request_stop();
+    CheckBudget cancelled;
+    cancelled.stop = stop.get_token();
+    BracketChecker checker;
+    string source;
+    for (const string& line : lines) {
+        source += line + "\n";
+    }
+    ASSERT_EQ(checker.check(source, &cancelled).size(), 1u);
+    EXPECT_EQ(checker.errors()[0].type, BUDGET_EXCEEDED);
+
+    ofstream("test_budget.cpp", ios::binary) << source;
+    CheckBudget fileBudget;
+    fileBudget.maxBytes = 1000;
+    bool opened = false;
+    EXPECT_TRUE(read_input_file("test_budget.cpp", &opened, &fileBudget).empty());
+    EXPECT_TRUE(opened);
+    EXPECT_TRUE(fileBudget.exceeded);
+}
+
+/**
+ * @test StatsMergeAndJson
+ * @brief Tests that statistics of two files merge and are written as JSON.
+ */
+TEST(testBracketChecker2, StatsMergeAndJson) {
+    CheckStats first;
+    {
+        PhaseTimer timer(first.phases[PHASE_PARSE]);
+        first.count_input({ "int main() {", "    return (1];" });
+        first.count_errors(parse_brackets({ "int main() {", "    return (1];" }));
+    }
+    first.maxDepth = 2;
+    EXPECT_GE(first.phases[PHASE_PARSE].wallSeconds, 0.0);
+
+    CheckStats second;
+    second.count_input({ "{}" });
+    second.maxDepth = 1;
+    second.peakRssBytes = peak_rss_bytes();
+
+    first.merge(second);
+    EXPECT_EQ(first.files, 2u);
+    EXPECT_EQ(first.lines, 3u);
+    EXPECT_EQ(first.bytes, 13u + 16u + 3u);
+    EXPECT_EQ(first.maxDepth, 2);
+    EXPECT_EQ(first.errorCounts[WRONG_BRACKET], 1u);
+    EXPECT_EQ(first.errorCounts[UNMATCHED_BRACKET], 2u);
+    EXPECT_GT(first.peakRssBytes, 0u);
+
+    ostringstream json;
+    print_stats(json, first, true);
+    EXPECT_NE(json.str().find("\"files\": 2"), string::npos);
+    EXPECT_NE(json.str().find("\"parse\": {\"wallMs\""), string::npos);
+    EXPECT_NE(json.str().find("\"UNMATCHED_BRACKET\": 2"), string::npos);
+
+    // Phase times summed over workers are labelled as such; the run's own wall time gives the rate
+    first.workers = 4;
+    first.runWallSeconds = 0.5;
+    ostringstream text;
+    print_stats(text, first, false);
+    EXPECT_NE(text.str().find("Worker ms"), string::npos);
+    EXPECT_EQ(text.str().find("Wall ms"), string::npos);
+    EXPECT_NE(text.str().find("Run: 500.000 ms wall on 4 threads"), string::npos);
+}
+
+/**
+ * @test PerfCountersDegradeGracefully
+ * @brief Tests that counters either measure or explain why they cannot, without failing the check.
+ */
+TEST(testBracketChecker2, PerfCountersDegradeGracefully) {
+    PerfCounterGroup group;
+    EXPECT_EQ(group.available(), group.unavailable_reason().empty());
+
+    CounterValues phases[PHASE_COUNT];
+    vector<string> lines(1000, "if (a[i]) { b(); }");
+    {
+        CounterScope counting(group.available() ? &group : nullptr, phases[PHASE_PARSE]);
+        EXPECT_TRUE(parse_brackets(lines).empty());
+    }
+    if (group.available()) {
+        bool any = false;
+        for (size_t k = 0; k < COUNTER_COUNT; k++) {
+            any = any || (phases[PHASE_PARSE].valid[k] && phases[PHASE_PARSE].counts[k] > 0);
+        }
+        EXPECT_TRUE(any);
+    }
+
+    ostringstream report;
+    print_counters(report, phases, 19000);
+    EXPECT_NE(report.str().find("parse"), string::npos);
+}
+
+/**
+ * @test TraceSpansFromWorkerThreads
+ * @brief Tests that spans of several threads are written as Chrome trace events.
+ */
+TEST(testBracketChecker2, TraceSpansFromWorkerThreads) {
+    string file = "dir\\a \"quoted\".cpp";
+    { TraceSpan ignored("ignored"); }  // Tracing is off
+
+    start_tracing();
+    vector<thread> workers;
+    for (int i = 0; i < 3; i++) {
+        workers.emplace_back([&file] {
+            TraceSpan span("check", &file);
+            span.set_bytes(42);
+            span.set_errors(1);
+            TraceSpan phase("parse", &file);
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    ASSERT_TRUE(write_trace("test_trace.json"));
+    EXPECT_FALSE(tracing_enabled());
+
+    ifstream input("test_trace.json");
+    string json((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+    size_t spans = 0;
+    for (size_t pos = json.find("\"ph\": \"X\""); pos != string::npos; pos = json.find("\"ph\": \"X\"", pos + 1)) {
+        spans++;
+    }
+    EXPECT_EQ(spans, 6u);
+    EXPECT_EQ(json.find("ignored"), string::npos);
+    EXPECT_NE(json.find("\"file\": \"dir\\\\a \\\"quoted\\\".cpp\", \"bytes\": 42, \"errors\": 1"), string::npos);
+    EXPECT_EQ(json.front(), '{');
+    EXPECT_EQ(json.substr(json.size() - 2), "}\n");
+}
+
+/**
+ * @test LatencyHistogramAndTopFiles
+ * @brief Tests latency percentiles, lock-free recording from threads and the top-N file lists.
+ */
+TEST(testBracketChecker2, LatencyHistogramAndTopFiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.percentile(0.5), 0u);
+
+    // 1..1000 microseconds recorded by four threads
+    vector<thread> workers;
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([&histogram, t] {
+            for (uint64_t us = 1 + t; us <= 1000; us += 4) {
+                histogram.record(us * 1000);
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    ASSERT_EQ(histogram.count(), 1000u);
+    const double fractions[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (double fraction : fractions) {
+        double expected = fraction * 1000 * 1000;
+        double actual = static_cast<double>(histogram.percentile(fraction));
+        EXPECT_GE(actual, expected);
+        EXPECT_LE(actual, expected * 1.04);
+    }
+    EXPECT_EQ(histogram.percentile(0), histogram.percentile(0.001));
+
+    LatencyHistogram other;
+    other.record(5);
+    other.record(UINT64_MAX);
+    histogram.merge(other);
+    EXPECT_EQ(histogram.count(), 1002u);
+    EXPECT_EQ(histogram.percentile(1), UINT64_MAX);
+    EXPECT_EQ(histogram.percentile(0), 5u);
+
+    TopFiles first(2), second(2);
+    for (int i = 0; i < 5; i++) {
+        FileTiming file;
+        file.path = "f" + to_string(i);
+        file.seconds = i;
+        file.bytes = 10 - i;
+        (i % 2 ? first : second).add(file);
+    }
+    first.merge(second);
+    ASSERT_EQ(first.slowest().size(), 2u);
+    EXPECT_EQ(first.slowest()[0].path, "f4");
+    EXPECT_EQ(first.slowest()[1].path, "f3");
+    ASSERT_EQ(first.largest().size(), 2u);
+    EXPECT_EQ(first.largest()[0].path, "f0");
+    EXPECT_EQ(first.largest()[1].path, "f1");
+
+    ostringstream report;
+    print_latency_report(report, histogram, first);
+    EXPECT_NE(report.str().find("p99.9="), string::npos);
+    EXPECT_NE(report.str().find("Slowest files:"), string::npos);
+}
+
+/**
+ * @test GeneratedCorpusMatchesGroundTruth
+ * @brief Tests generated sources against their simulated errors, with CRLF, BOM, escapes and non-ASCII comments.
+ */
+TEST(testBracketChecker2, GeneratedCorpusMatchesGroundTruth) {
+    CorpusOptions options;
+    options.seed = 7;
+    string first = generate_source(options).text;
+    EXPECT_EQ(generate_source(options).text, first);
+    options.seed = 8;
+    EXPECT_NE(generate_source(options).text, first);
+
+    size_t withErrors = 0;
+    for (uint64_t seed = 1; seed <= 200; seed++) {
+        options = CorpusOptions();
+        options.seed = seed;
+        options.bytes = 500 + static_cast<size_t>(seed * 97 % 20000);
+        options.maxDepth = 1 + static_cast<int>(seed % 40);
+        options.stringDensity = seed % 4 * 0.2;
+        options.errorDensity = seed % 3 == 0 ? 0.02 : 0.0;
+        options.crlf = seed % 2 == 0;
+        options.bom = seed % 5 == 0;
+        GeneratedSource source = generate_source(options);
+        withErrors += !source.expected.empty();
+        if (options.errorDensity == 0) {
+            EXPECT_TRUE(source.expected.empty()) << "seed " << seed;
+        }
+
+        {
+            ofstream out("test_corpus.cpp", ios::binary);
+            out << source.text;
+        }
+        vector<string> lines = read_input_file("test_corpus.cpp");
+        ASSERT_EQ(lines.size(), source.lineCount) << "seed " << seed;
+        EXPECT_EQ(code_validation(lines).empty(), lines.size() < MAX_PROGRAM_LINES) << "seed " << seed;
+        EXPECT_EQ(parse_brackets(lines, LANGUAGE_CPP), source.expected) << "seed " << seed;
+        EXPECT_EQ(brackets_balanced(lines, LANGUAGE_CPP), source.expected.empty()) << "seed " << seed;
+    }
+    EXPECT_GT(withErrors, 30u);
+}
+
+/**
+ * @test AdversarialInputsStayLinear
+ * @brief Tests that backslash storms, deep nesting and unterminated comments take linear time and that the depth limit bounds the stack.
+ */
+TEST(testBracketChecker2, AdversarialInputsStayLinear) {
+    auto storm = [](size_t size) {  // Quotes behind long odd runs of backslashes, then a real closing quote
+        string line = "x = \"";
+        while (line.size() < size) {
+            line += string(999, '\\') + "\"";
+        }
+        return vector<string>{ line + "\\\\\"" };
+    };
+    auto nesting = [](size_t size) {
+        return vector<string>{ string(size, '(') };
+    };
+    auto comment = [](size_t size) {
+        return vector<string>{ "/*" + string(size, '*') };
+    };
+
+    // Fastest of three runs of a check, in seconds
+    auto seconds = [](auto check) {
+        double best = 1e9;
+        for (int run = 0; run < 3; run++) {
+            auto start = chrono::steady_clock::now();
+            check();
+            best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    };
+
+    const size_t small = 1 << 20, large = 8 << 20;
+    vector<string> smallStorm = storm(small), largeStorm = storm(large);
+    EXPECT_TRUE(parse_brackets(largeStorm, LANGUAGE_CPP).empty());
+    EXPECT_TRUE(bracket_check(largeStorm[0]).ok);
+    // 8x the input may take at most 24x the time; a quadratic scan would take 64x
+    EXPECT_LT(seconds([&] { parse_brackets(largeStorm, LANGUAGE_CPP); }),
+        24 * seconds([&] { parse_brackets(smallStorm, LANGUAGE_CPP); }) + 1e-3);
+    EXPECT_LT(seconds([&] { bracket_check(largeStorm[0]); }),
+        24 * seconds([&] { bracket_check(smallStorm[0]); }) + 1e-3);
+
+    vector<string> smallNesting = nesting(small), largeNesting = nesting(large);
+    EXPECT_LT(seconds([&] { brackets_balanced(largeNesting, LANGUAGE_CPP); }),
+        24 * seconds([&] { brackets_balanced(smallNesting, LANGUAGE_CPP); }) + 1e-3);
+    vector<string> smallComment = comment(small), largeComment = comment(large);
+    EXPECT_TRUE(parse_brackets(largeComment, LANGUAGE_CPP).empty());
+    EXPECT_LT(seconds([&] { parse_brackets(largeComment, LANGUAGE_CPP); }),
+        24 * seconds([&] { parse_brackets(smallComment, LANGUAGE_CPP); }) + 1e-3);
+
+    // The depth limit stops a million-deep nesting at the first bracket beyond it
+    CheckBudget budget;
+    budget.maxDepth = 1000;
+    set<BracketError> expected = { { '\0', 1, 1001, BUDGET_EXCEEDED } };
+    EXPECT_EQ(parse_brackets(largeNesting, LANGUAGE_CPP, &budget), expected);
+    EXPECT_TRUE(budget.exceeded);
+    budget.exceeded = false;
+    EXPECT_FALSE(brackets_balanced(largeNesting, LANGUAGE_CPP, &budget));
+    EXPECT_TRUE(budget.exceeded);
+
+    string text;
+    for (int line = 0; line < 900; line++) {
+        text += string(500, '{') + "\n";
+    }
+    budget.exceeded = false;
+    BracketChecker checker;
+    const auto& errors = checker.check(text, &budget);
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_EQ(errors[0], (BracketError{ '\0', 3, 1, BUDGET_EXCEEDED }));
+    EXPECT_LE(checker.max_depth(), 1001);
+}
+
+/**
+ * @test PhaseAllocationBudgets
+ * @brief Tests that each phase stays within its allocation budget.
+ */
+TEST(testBracketChecker2, PhaseAllocationBudgets) {
+    ASSERT_TRUE(alloc_tracking_enabled());
+    string source;
+    for (int i = 0; i < 200; i++) {
+        source += "    if (values[" + to_string(i) + "] > limit) { call(\"(\", '}'); } // a comment that does not fit SSO\n";
+    }
+    source += "( ]\n";
+    ofstream("test_alloc.cpp", ios::binary) << source;
+
+    AllocCounts read, validate, parse, balanced, print, nested;
+    vector<string> lines;
+    set<BracketError> errors;
+    {
+        AllocScope scope(read);
+        lines = read_input_file("test_alloc.cpp");
+    }
+    {
+        AllocScope scope(validate);
+        EXPECT_TRUE(code_validation(lines).empty());
+    }
+    {
+        AllocScope scope(balanced);
+        EXPECT_FALSE(brackets_balanced(lines, LANGUAGE_CPP));
+    }
+    {
+        AllocScope scope(parse);
+        errors = parse_brackets(lines, LANGUAGE_CPP);
+    }
+    {
+        AllocScope scope(print);
+        EXPECT_TRUE(print_result("test_alloc_result.txt", errors));
+        AllocScope inner(nested);
+        vector<int> ignored(100);
+    }
+    ASSERT_EQ(lines.size(), 201u);
+    ASSERT_EQ(errors.size(), 2u);
+
+    // Reading allocates about once per line, the scans only for stack growth and errors
+    EXPECT_LE(read.count, lines.size() + 16);
+    EXPECT_LE(read.bytes, 6 * source.size());
+    EXPECT_EQ(validate.count, 0u);
+    EXPECT_EQ(balanced.count, 0u);
+    EXPECT_LE(parse.count, errors.size() + 8);
+    EXPECT_LE(print.count, 4u);
+    EXPECT_EQ(nested.count, 1u);
+    EXPECT_EQ(nested.bytes, 100 * sizeof(int));
+}
+
+/**
+ * @test DirectoryWalkFindsSourcesOnce
+ * @brief The parallel walk visits every matching file once, follows new
+ * directory links and skips a link back into the walked tree.
+ */
+TEST(testBracketChecker2, DirectoryWalkFindsSourcesOnce) {
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "bracketchecker_walk_test";
+    fs::path outside = fs::temp_directory_path() / "bracketchecker_walk_outside";
+    fs::remove_all(root);
+    fs::remove_all(outside);
+    fs::create_directories(root / "src" / "detail");
+    fs::create_directories(outside);
+    for (const char* file : { "src/a.cpp", "src/b.h", "src/detail/c.inl", "src/notes.txt", "d.hpp" }) {
+        ofstream(root / file) << "int main() { return 0; }" << endl;
+    }
+    ofstream(outside / "e.cc") << "int e() { return (1; }" << endl;
+
+    bool links = true;
+    error_code error;
+    fs::create_directory_symlink(root, root / "src" / "loop", error);
+    links = links && !error;
+    fs::create_directory_symlink(outside, root / "external", error);
+    links = links && !error;
+
+    mutex lock;
+    multiset<string> visited;
+    set<unsigned> workers;
+    WalkOptions options;
+    options.threads = 4;
+    WalkSummary summary = walk_source_tree(root.string(), options, [&](const string& path, unsigned worker) {
+        lock_guard<mutex> guard(lock);
+        visited.insert(fs::path(path).lexically_relative(root).generic_string());
+        workers.insert(worker);
+    });
+
+    multiset<string> expected = { "d.hpp", "src/a.cpp", "src/b.h", "src/detail/c.inl" };
+    if (links) {
+        expected.insert("external/e.cc");
+        EXPECT_EQ(summary.skippedLinks, 1u);
+    }
+    EXPECT_EQ(visited, expected);
+    EXPECT_EQ(summary.files, expected.size());
+    EXPECT_EQ(summary.unreadable, 0u);
+    EXPECT_LT(*workers.rbegin(), 4u);
+
+    EXPECT_EQ(parse_extension_list("cpp,.h,"), (vector<string>{ ".cpp", ".h" }));
+    EXPECT_TRUE(has_source_extension("a/b.inl", default_source_extensions()));
+    EXPECT_FALSE(has_source_extension("a/b.txt", default_source_extensions()));
+    EXPECT_FALSE(has_source_extension(".h", { ".h" }));
+
+    WalkSummary missing = walk_source_tree((root / "missing").string(), options, [](const string&, unsigned) {});
+    EXPECT_EQ(missing.unreadable, 1u);
+    EXPECT_EQ(missing.files, 0u);
+
+    fs::remove_all(root);
+    fs::remove_all(outside);
+}
+
+/**
+ * @test PathFilterFollowsGitignoreRules
+ * @brief Literal, suffix, anchored and wildcard rules match as in git, the
+ * last matching rule wins, and ignored directories are never listed.
+ */
+TEST(testBracketChecker2, PathFilterFollowsGitignoreRules) {
+    PathFilter filter;
+    for (const char* line : { "# comment", "", "build/", "*.gen.cpp", "/third_party", "docs/**/*.h",
+        "out/**", "tmp?", "[Ll]egacy*", "!keep.gen.cpp", "**/cache" }) {
+        filter.add_pattern(line);
+    }
+    filter.add_pattern("*.h", "sub");
+
+    EXPECT_TRUE(filter.ignored("build", true));
+    EXPECT_TRUE(filter.ignored("a/b/build", true));
+    EXPECT_FALSE(filter.ignored("build", false));
+    EXPECT_TRUE(filter.ignored("src/x.gen.cpp", false));
+    EXPECT_FALSE(filter.ignored("src/keep.gen.cpp", false));
+    EXPECT_TRUE(filter.ignored("third_party", true));
+    EXPECT_FALSE(filter.ignored("src/third_party", true));
+    EXPECT_TRUE(filter.ignored("docs/a.h", false));
+    EXPECT_TRUE(filter.ignored("docs/x/y/a.h", false));
+    EXPECT_FALSE(filter.ignored("docs/a.cpp", false));
+    EXPECT_FALSE(filter.ignored("out", true));
+    EXPECT_TRUE(filter.ignored("out/debug/a.cpp", false));
+    EXPECT_TRUE(filter.ignored("tmp1", true));
+    EXPECT_FALSE(filter.ignored("tmp12", true));
+    EXPECT_TRUE(filter.ignored("src/legacy_io.cpp", false));
+    EXPECT_TRUE(filter.ignored("src/Legacy", true));
+    EXPECT_TRUE(filter.ignored("cache", true));
+    EXPECT_TRUE(filter.ignored("a/b/cache", true));
+    EXPECT_TRUE(filter.ignored("sub/a.h", false));
+    EXPECT_TRUE(filter.ignored("sub/x/a.h", false));
+    EXPECT_FALSE(filter.ignored("a.h", false));
+    EXPECT_FALSE(filter.ignored("src/main.cpp", false));
+
+    GlobPattern glob("a*b?[c-e]");
+    EXPECT_TRUE(glob.matches("ab1c"));
+    EXPECT_TRUE(glob.matches("aXXXbZe"));
+    EXPECT_FALSE(glob.matches("a/b1c"));
+    EXPECT_FALSE(glob.matches("ab1f"));
+    // A long run of stars against a near miss stays fast: no backtracking
+    EXPECT_FALSE(GlobPattern("*a*a*a*a*a*a*a*a*b").matches(string(10000, 'a')));
+
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "bracketchecker_filter_test";
+    fs::remove_all(root);
+    fs::create_directories(root / "build" / "deep");
+    fs::create_directories(root / "src" / "generated");
+    fs::create_directories(root / "vendor");
+    for (const char* file : { "build/deep/a.cpp", "src/main.cpp", "src/generated/g.cpp", "src/x.h", "vendor/v.cpp" }) {
+        ofstream(root / file) << "int f() { return 0; }" << endl;
+    }
+    ofstream(root / ".gitignore") << "build/" << endl;
+    ofstream(root / "src" / ".gitignore") << "generated" << endl << "*.h" << endl;
+
+    WalkOptions options;
+    options.threads = 2;
+    options.exclude.add_pattern("/vendor");
+    mutex lock;
+    set<string> visited;
+    WalkSummary summary = walk_source_tree(root.string(), options, [&](const string& path, unsigned) {
+        lock_guard<mutex> guard(lock);
+        visited.insert(fs::path(path).lexically_relative(root).generic_string());
+    });
+    EXPECT_EQ(visited, (set<string>{ "src/main.cpp" }));
+    EXPECT_EQ(summary.ignored, 4u);
+    // root and src only: build, vendor and src/generated are pruned unlisted
+    EXPECT_EQ(summary.directories, 2u);
+
+    options.readIgnoreFiles = false;
+    visited.clear();
+    walk_source_tree(root.string(), options, [&](const string& path, unsigned) {
+        lock_guard<mutex> guard(lock);
+        visited.insert(fs::path(path).lexically_relative(root).generic_string());
+    });
+    EXPECT_EQ(visited.size(), 4u);
+    fs::remove_all(root);
+}
+
+/**
+ * @test CompileCommandsListsEachSourceOnce
+ * @brief The streaming reader resolves and deduplicates the files of a
+ * compilation database, skips the other members and reports malformed input.
+ */
+TEST(testBracketChecker2, CompileCommandsListsEachSourceOnce) {
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "bracketchecker_compdb_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    string directory = root.generic_string();
+    {
+        ofstream database(root / "compile_commands.json");
+        database << "[\n"
+            << "  { \"directory\": \"" << directory << "\", \"command\": \"c++ -c a.cpp -DX=\\\"[\\\"\", \"file\": \"a.cpp\" },\n"
+            << "  { \"arguments\": [\"c++\", \"-O2\", \"-c\", \"src/../a.cpp\"], \"directory\": \"" << directory << "\", \"file\": \"src/../a.cpp\" },\n"
+            << "  { \"directory\": \"sub\", \"file\": \"b\\u00e9.cc\", \"output\": null, \"extra\": {\"n\": [1, 2.5e3, true]} },\n"
+            << "  { \"directory\": \"" << directory << "\", \"file\": \"" << directory << "/c.h\" }\n"
+            << "]\n";
+    }
+    vector<string> files;
+    string error;
+    ASSERT_TRUE(read_compile_commands((root / "compile_commands.json").string(), files, error)) << error;
+    ASSERT_EQ(files.size(), 3u);
+    EXPECT_EQ(fs::path(files[0]), (root / "a.cpp").lexically_normal());
+    EXPECT_EQ(fs::path(files[1]), (root / "sub" / "b\xC3\xA9.cc").lexically_normal());
+    EXPECT_EQ(fs::path(files[2]), (root / "c.h").lexically_normal());
+
+    ofstream(root / "empty.json") << " [ ] ";
+    EXPECT_TRUE(read_compile_commands((root / "empty.json").string(), files, error));
+    EXPECT_TRUE(files.empty());
+
+    ofstream(root / "broken.json") << "[ { \"file\": \"a.cpp\", \"directory\" } ]";
+    EXPECT_FALSE(read_compile_commands((root / "broken.json").string(), files, error));
+    EXPECT_NE(error.find("at byte"), string::npos);
+    EXPECT_FALSE(read_compile_commands((root / "missing.json").string(), files, error));
+    fs::remove_all(root);
+}
+
+/**
+ * @test GitDiffReadsChangedBlobs
+ * @brief Only files with new contents between two commits are listed, a
+ * pure rename is skipped, a new copy of another file's old contents is
+ * listed, and blobs are read as committed, not from the working tree.
+ */
+TEST(testBracketChecker2, GitDiffReadsChangedBlobs) {
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "bracketchecker_git_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    string repository = root.string();
+    string output;
+    string error;
+    if (!run_git(repository, { "init", "-q" }, output, error)) {
+        GTEST_SKIP() << "git is not available: " << error;
+    }
+    auto commit = [&](const char* message) {
+        ASSERT_TRUE(run_git(repository, { "add", "-A" }, output, error)) << error;
+        ASSERT_TRUE(run_git(repository, { "-c", "user.name=test", "-c", "user.email=test@example.com",
+            "commit", "-q", "-m", message }, output, error)) << error;
+        ASSERT_TRUE(run_git(repository, { "rev-parse", "HEAD" }, output, error)) << error;
+    };
+
+    ofstream(root / "same.cpp") << "int same() { return 0; }" << endl;
+    ofstream(root / "edit.cpp") << "int edit() { return 0; }" << endl;
+    ofstream(root / "gone.cpp") << "int gone() { return 0; }" << endl;
+    commit("base");
+    string base = output.substr(0, output.find('\n'));
+
+    ofstream(root / "edit.cpp") << "int edit() { return (0; }" << endl;
+    fs::rename(root / "gone.cpp", root / "renamed.cpp");
+    fs::create_directories(root / "sub dir");
+    ofstream(root / "sub dir" / "new.h") << "struct S { int a[2]; };" << endl;
+    fs::copy_file(root / "same.cpp", root / "copy.cpp");
+    // The old contents of edit.cpp come back as a new file, which still has to be checked
+    ofstream(root / "old_edit.cpp") << "int edit() { return 0; }" << endl;
+    commit("head");
+    string head = output.substr(0, output.find('\n'));
+    // The working tree differs from the head commit; the blob must win
+    ofstream(root / "edit.cpp") << "int edit() { return 0; }" << endl;
+
+    string rangeBase;
+    string rangeHead;
+    ASSERT_TRUE(split_revision_range(base + ".." + head, rangeBase, rangeHead));
+    EXPECT_EQ(rangeBase, base);
+    EXPECT_FALSE(split_revision_range("main", rangeBase, rangeHead));
+    EXPECT_FALSE(split_revision_range("--output=x..main", rangeBase, rangeHead));
+
+    vector<GitChange> changes;
+    ASSERT_TRUE(list_changed_files(repository, base, head, changes, error)) << error;
+    // renamed.cpp has the blob of gone.cpp, so only its name changed
+    ASSERT_EQ(changes.size(), 4u);
+    EXPECT_EQ(changes[0].path, "copy.cpp");
+    EXPECT_EQ(changes[1].path, "edit.cpp");
+    EXPECT_EQ(changes[2].path, "old_edit.cpp");
+    EXPECT_EQ(changes[3].path, "sub dir/new.h");
+
+    GitBlobReader reader(repository);
+    ASSERT_TRUE(reader.running());
+    string contents;
+    ASSERT_TRUE(reader.read(changes[1].blobId, contents));
+    EXPECT_EQ(contents, "int edit() { return (0; }\n");
+    EXPECT_FALSE(reader.read(string(40, '0'), contents));
+    ASSERT_TRUE(reader.read(changes[3].blobId, contents));
+    EXPECT_EQ(contents, "struct S { int a[2]; };\n");
+
+    EXPECT_FALSE(list_changed_files(repository, base, "no-such-revision", changes, error));
+    fs::remove_all(root);
+}
+
+/**
+ * @test GitHistoryListsChangesPerCommit
+ * @brief The history of a range starts from the files before its first
+ * commit and lists, oldest first, what each commit changed; a deleted file
+ * has no blob and a reverted file gets its earlier blob id back.
+ */
+TEST(testBracketChecker2, GitHistoryListsChangesPerCommit) {
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "bracketchecker_history_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    string repository = root.string();
+    string output;
+    string error;
+    if (!run_git(repository, { "init", "-q" }, output, error)) {
+        GTEST_SKIP() << "git is not available: " << error;
+    }
+    vector<string> ids;
+    auto commit = [&](const char* message) {
+        ASSERT_TRUE(run_git(repository, { "add", "-A" }, output, error)) << error;
+        ASSERT_TRUE(run_git(repository, { "-c", "user.name=test", "-c", "user.email=test@example.com",
+            "commit", "-q", "-m", message }, output, error)) << error;
+        ASSERT_TRUE(run_git(repository, { "rev-parse", "HEAD" }, output, error)) << error;
+        ids.push_back(output.substr(0, output.find('\n')));
+    };
+
+    ofstream(root / "a.cpp") << "int a() { return 0; }" << endl;
+    ofstream(root / "b.cpp") << "int b() { return 0; }" << endl;
+    commit("first");
+    ofstream(root / "a.cpp") << "int a() { return (0; }" << endl;
+    commit("break");
+    ofstream(root / "a.cpp") << "int a() { return 0; }" << endl;
+    fs::remove(root / "b.cpp");
+    commit("revert");
+
+    vector<GitChange> baseline;
+    vector<GitCommitChanges> commits;
+    ASSERT_TRUE(list_history(repository, "HEAD", baseline, commits, error)) << error;
+    EXPECT_TRUE(baseline.empty());
+    ASSERT_EQ(commits.size(), 3u);
+    EXPECT_EQ(commits[0].commit, ids[0]);
+    ASSERT_EQ(commits[0].changes.size(), 2u);
+    string clean = commits[0].changes[0].blobId;
+
+    ASSERT_TRUE(list_history(repository, ids[0] + "..HEAD", baseline, commits, error)) << error;
+    ASSERT_EQ(baseline.size(), 2u);
+    EXPECT_EQ(baseline[0].path, "a.cpp");
+    EXPECT_EQ(baseline[0].blobId, clean);
+    ASSERT_EQ(commits.size(), 2u);
+    EXPECT_EQ(commits[0].commit, ids[1]);
+    ASSERT_EQ(commits[0].changes.size(), 1u);
+    EXPECT_NE(commits[0].changes[0].blobId, clean);
+    ASSERT_EQ(commits[1].changes.size(), 2u);
+    EXPECT_EQ(commits[1].changes[0].path, "a.cpp");
+    EXPECT_EQ(commits[1].changes[0].blobId, clean);
+    EXPECT_EQ(commits[1].changes[1].path, "b.cpp");
+    EXPECT_TRUE(commits[1].changes[1].blobId.empty());
+
+    EXPECT_FALSE(list_history(repository, "--all", baseline, commits, error));
+    fs::remove_all(root);
+}
+
+/**
+ * @test ShardsSplitFilesEvenlyAndMergeBack
+ * @brief Shard assignment does not depend on the order files are found,
+ * balances bytes across shards, and merging the shard results gives the
+ * sections in the order of a single run.
+ */
+TEST(testBracketChecker2, ShardsSplitFilesEvenlyAndMergeBack) {
+    ShardSpec shard;
+    ASSERT_TRUE(parse_shard("2/3", shard));
+    EXPECT_EQ(shard.index, 2u);
+    EXPECT_EQ(shard.count, 3u);
+    EXPECT_FALSE(parse_shard("0/3", shard));
+    EXPECT_FALSE(parse_shard("4/3", shard));
+    EXPECT_FALSE(parse_shard("1/", shard));
+    EXPECT_FALSE(parse_shard("-1/3", shard));
+    EXPECT_EQ(shard_hash(""), 14695981039346656037ull);
+    EXPECT_EQ(shard_hash("a"), 0xaf63dc4c8601ec8cull);
+
+    vector<ShardFile> files;
+    for (int i = 0; i < 200; i++) {
+        files.push_back({ "src/file" + to_string(i) + ".cpp", static_cast<uint64_t>(1000 + (i * 7919) % 50000) });
+    }
+    vector<unsigned> shards = assign_shards(files, 4);
+    uint64_t bytes[5] = {};
+    for (size_t i = 0; i < files.size(); i++) {
+        ASSERT_GE(shards[i], 1u);
+        ASSERT_LE(shards[i], 4u);
+        bytes[shards[i]] += files[i].bytes;
+    }
+    uint64_t lightest = *min_element(bytes + 1, bytes + 5);
+    uint64_t heaviest = *max_element(bytes + 1, bytes + 5);
+    EXPECT_LT(heaviest - lightest, 50000u);
+
+    vector<ShardFile> reversed(files.rbegin(), files.rend());
+    vector<unsigned> reversedShards = assign_shards(reversed, 4);
+    for (size_t i = 0; i < files.size(); i++) {
+        EXPECT_EQ(reversedShards[files.size() - 1 - i], shards[i]);
+    }
+
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "bracketchecker_shard_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    ofstream(root / "1.txt") << "File: b.cpp\nAll brackets are correctly closed.\n\n"
+        "File: d.cpp\nUnmatched or invalid constructs found: \nAt Line 1, Column 1: Unmatched opening bracket '{'.\n\n";
+    ofstream(root / "2.txt") << "File: a.cpp\nAll brackets are correctly closed.\n\n"
+        "File: c.cpp\nAll brackets are correctly closed.\n\n";
+    ofstream(root / "3.txt");
+    size_t merged = 0;
+    string error;
+    ASSERT_TRUE(merge_shard_results({ (root / "1.txt").string(), (root / "2.txt").string(), (root / "3.txt").string() },
+        (root / "merged.txt").string(), merged, error)) << error;
+    EXPECT_EQ(merged, 4u);
+    stringstream contents;
+    contents << ifstream(root / "merged.txt").rdbuf();
+    EXPECT_EQ(contents.str(), "File: a.cpp\nAll brackets are correctly closed.\n\n"
+        "File: b.cpp\nAll brackets are correctly closed.\n\n"
+        "File: c.cpp\nAll brackets are correctly closed.\n\n"
+        "File: d.cpp\nUnmatched or invalid constructs found: \nAt Line 1, Column 1: Unmatched opening bracket '{'.\n\n");
+
+    EXPECT_FALSE(merge_shard_results({ (root / "1.txt").string(), (root / "1.txt").string() },
+        (root / "merged.txt").string(), merged, error));
+    EXPECT_FALSE(merge_shard_results({ (root / "missing.txt").string() }, (root / "merged.txt").string(), merged, error));
+    fs::remove_all(root);
+}
+
+
+/**
+ * @test FastScanReportsNestingDepth
+ * @brief Tests that the production path learns the same nesting depth as the structure parser.
+ */
+TEST(testBracketChecker2, FastScanReportsNestingDepth) {
+    vector<string> balanced = { "int f() {", "    if (a[b[0]]) { g(); }", "}" };
+    BracketStructure structure;
+    parse_brackets(balanced, LANGUAGE_CPP, structure);
+    int depth = 0;
+    EXPECT_TRUE(brackets_balanced(balanced, LANGUAGE_CPP, nullptr, &depth));
+    EXPECT_EQ(depth, structure.maxDepth);
+    EXPECT_EQ(depth, 4);
+
+    // The fast scan stops at the wrong bracket; the parser that follows sees the rest
+    vector<string> broken = { "f(]", "{{{{{ }}}}}" };
+    depth = 0;
+    EXPECT_FALSE(brackets_balanced(broken, LANGUAGE_CPP, nullptr, &depth));
+    EXPECT_EQ(depth, 1);
+    EXPECT_EQ(parse_brackets(broken, LANGUAGE_CPP, nullptr, &depth).size(), 2u);
+    EXPECT_EQ(depth, 6);
+}
+
+/**
+ * @test PmrPipelineHonoursBudget
+ * @brief Tests that the arena pipeline used by batch runs applies byte and depth budgets and reports the depth.
+ */
+TEST(testBracketChecker2, PmrPipelineHonoursBudget) {
+    ofstream("test_pmr_budget.cpp", ios::binary) << "int f() {\n    g((a[0]));\n}\n";
+    pmr::memory_resource* arena = thread_arena();
+    {
+        CheckBudget budget;
+        budget.maxBytes = 8;
+        bool opened = false;
+        pmr::vector<pmr::string> lines = read_input_file("test_pmr_budget.cpp", arena, &opened, &budget);
+        EXPECT_TRUE(opened);
+        EXPECT_TRUE(budget.exceeded);
+        EXPECT_TRUE(lines.empty());
+
+        lines = read_input_file("test_pmr_budget.cpp", arena);
+        int depth = 0;
+        EXPECT_TRUE(brackets_balanced(lines, LANGUAGE_CPP, nullptr, &depth));
+        EXPECT_EQ(depth, 4);
+
+        CheckBudget shallow;
+        shallow.maxDepth = 2;
+        pmr::set<BracketError> errors = parse_brackets(lines, LANGUAGE_CPP, arena, &shallow);
+        ASSERT_EQ(errors.size(), 1u);
+        EXPECT_EQ(errors.begin()->type, BUDGET_EXCEEDED);
+    }
+    release_thread_arena();
+}
+
+/**
+ * @test NestedIgnoreFilesExtendTheirParent
+ * @brief A nested filter shares its parent's rules instead of copying them,
+ * its own rules decide first, and the walk never enters .git.
+ */
+TEST(testBracketChecker2, NestedIgnoreFilesExtendTheirParent) {
+    auto parent = make_shared<PathFilter>();
+    parent->add_pattern("*.gen.cpp");
+    parent->add_pattern("tmp/");
+    PathFilter child(parent);
+    EXPECT_FALSE(child.empty());
+    EXPECT_TRUE(child.ignored("src/x.gen.cpp", false));
+    child.add_pattern("!keep.gen.cpp", "src");
+    child.add_pattern("*.h", "src");
+    EXPECT_FALSE(child.ignored("src/keep.gen.cpp", false));
+    EXPECT_TRUE(child.ignored("src/x.gen.cpp", false));
+    EXPECT_TRUE(child.ignored("src/tmp", true));
+    EXPECT_TRUE(child.ignored("src/a.h", false));
+    EXPECT_FALSE(child.ignored("a.h", false));
+    EXPECT_TRUE(parent->ignored("src/keep.gen.cpp", false));
+    EXPECT_FALSE(parent->ignored("src/a.h", false));
+
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "bracketchecker_nested_ignore_test";
+    fs::remove_all(root);
+    fs::create_directories(root / ".git" / "objects" / "ab");
+    fs::create_directories(root / "src" / "lib");
+    for (const char* file : { ".git/objects/ab/c.cpp", "src/a.gen.cpp", "src/keep.gen.cpp", "src/lib/b.gen.cpp" }) {
+        ofstream(root / file) << "int f() { return 0; }" << endl;
+    }
+    ofstream(root / ".gitignore") << "*.gen.cpp" << endl;
+    ofstream(root / "src" / ".gitignore") << "!keep.gen.cpp" << endl;
+
+    WalkOptions options;
+    options.threads = 2;
+    mutex lock;
+    set<string> visited;
+    WalkSummary summary = walk_source_tree(root.string(), options, [&](const string& path, unsigned) {
+        lock_guard<mutex> guard(lock);
+        visited.insert(fs::path(path).lexically_relative(root).generic_string());
+    });
+    EXPECT_EQ(visited, (set<string>{ "src/keep.gen.cpp" }));
+    EXPECT_EQ(summary.directories, 3u);
+    fs::remove_all(root);
+}
+
+/**
+ * @test ExcludedDirectoriesHideListedFiles
+ * @brief For file lists that are not walked, such as a compilation database,
+ * a directory pattern excludes every file below the directory.
+ */
+TEST(testBracketChecker2, ExcludedDirectoriesHideListedFiles) {
+    PathFilter exclude;
+    exclude.add_pattern("third_party/");
+    exclude.add_pattern("/build");
+    exclude.add_pattern("!keep.cpp");
+    EXPECT_FALSE(exclude.ignored("build/a.cpp", false));
+    EXPECT_TRUE(exclude.ignored_file("build/a.cpp"));
+    EXPECT_TRUE(exclude.ignored_file("third_party/x.cpp"));
+    EXPECT_TRUE(exclude.ignored_file("src/third_party/lib/y.h"));
+    // As in git, a file cannot be re-included below an excluded directory
+    EXPECT_TRUE(exclude.ignored_file("third_party/keep.cpp"));
+    EXPECT_FALSE(exclude.ignored_file("src/build/a.cpp"));
+    EXPECT_FALSE(exclude.ignored_file("src/third_party.cpp"));
+    EXPECT_FALSE(PathFilter().ignored_file("third_party/x.cpp"));
+}
+
+/**
+ * @test BudgetTimeoutIsPerFile
+ * @brief Many fast files of a parallel walk all finish under a timeout far
+ * shorter than the walk, since each file's timeout starts with that file.
+ */
+TEST(testBracketChecker2, BudgetTimeoutIsPerFile) {
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "bracketchecker_timeout_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    for (int i = 0; i < 200; i++) {
+        ofstream(root / ("f" + to_string(i) + ".cpp")) << "int f() { return (1 + 2); }" << endl;
+    }
+
+    CheckBudget runBudget;
+    runBudget.timeout = chrono::milliseconds(50);
+    WalkOptions options;
+    options.threads = 4;
+    atomic<size_t> checked{ 0 };
+    atomic<size_t> exceeded{ 0 };
+    auto start = chrono::steady_clock::now();
+    walk_source_tree(root.string(), options, [&](const string& path, unsigned) {
+        // Files wait their turn, so the walk as a whole outlasts the timeout
+        this_thread::sleep_for(chrono::milliseconds(2));
+        CheckBudget fileBudget = runBudget;
+        fileBudget.start();
+        vector<string> lines = read_input_file(path, nullptr, &fileBudget);
+        set<BracketError> errors = parse_brackets(lines, LANGUAGE_CPP, &fileBudget);
+        checked++;
+        if (fileBudget.exceeded || !errors.empty()) {
+            exceeded++;
+        }
+    });
+    EXPECT_GT(chrono::steady_clock::now() - start, runBudget.timeout);
+    EXPECT_EQ(checked.load(), 200u);
+    EXPECT_EQ(exceeded.load(), 0u);
+
+    CheckBudget unlimited;
+    unlimited.start();
+    EXPECT_EQ(unlimited.deadline, chrono::steady_clock::time_point::max());
+
+    fs::remove_all(root);
+}
+
+/**
+ * @test DirectoryLinksAreFollowedTheSameEveryRun
+ * @brief A link into a directory that another link also reaches is still
+ * followed, whichever worker gets to it first, and a link that leads back
+ * up its own way is skipped.
+ */
+TEST(testBracketChecker2, DirectoryLinksAreFollowedTheSameEveryRun) {
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "bracketchecker_links_test";
+    fs::path outside = fs::temp_directory_path() / "bracketchecker_links_outside";
+    fs::remove_all(root);
+    fs::remove_all(outside);
+    fs::create_directories(root);
+    fs::create_directories(outside / "y");
+    ofstream(outside / "x.cpp") << "int x() { return 0; }" << endl;
+    ofstream(outside / "y" / "y.cpp") << "int y() { return 0; }" << endl;
+    error_code error;
+    fs::create_directory_symlink(outside / "y", root / "inner", error);
+    if (!error) {
+        fs::create_directory_symlink(outside, root / "outer", error);
+    }
+    if (!error) {
+        fs::create_directory_symlink(outside, outside / "y" / "up", error);
+    }
+    if (error) {
+        fs::remove_all(root);
+        fs::remove_all(outside);
+        GTEST_SKIP() << "directory links are not available: " << error.message();
+    }
+
+    multiset<string> expected = { "inner/y.cpp", "outer/x.cpp", "outer/y/y.cpp" };
+    WalkOptions options;
+    options.threads = 8;
+    for (int run = 0; run < 20; run++) {
+        mutex lock;
+        multiset<string> visited;
+        WalkSummary summary = walk_source_tree(root.string(), options, [&](const string& path, unsigned) {
+            lock_guard<mutex> guard(lock);
+            visited.insert(fs::path(path).lexically_relative(root).generic_string());
+        });
+        ASSERT_EQ(visited, expected);
+        // inner/up and outer/y/up both lead back above the directory holding them
+        EXPECT_EQ(summary.skippedLinks, 2u);
+    }
+
+    fs::remove_all(root);
+    fs::remove_all(outside);
+}
 
 /**
  * @brief Comparison operator for BracketError to support EXPECT_EQ.